@@ -0,0 +1,535 @@
+/**
+ * @file
+ * @brief `--batch` mode of the dot command
+ */
+
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#include "config.h"
+
+#include "batch.h"
+#include <cgraph/agxbuf.h>
+#include <cgraph/alloc.h>
+#include <cgraph/cgraph.h>
+#include <cgraph/startswith.h>
+#include <common/globals.h>
+#include <ctype.h>
+#include <errno.h>
+#include <gvc/gvc.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/// state of one input graph, from being handed to a worker until its output is
+/// written
+typedef struct {
+  enum { SLOT_FREE, SLOT_RUNNING, SLOT_DONE } state;
+  int status; ///< worst error status of the graph
+  agxbuf out; ///< captured stdout
+  agxbuf err; ///< captured stderr
+#ifndef _WIN32
+  pid_t pid;
+  int out_fd; ///< read end of the worker's stdout, -1 when closed
+  int err_fd; ///< read end of the worker's stderr, -1 when closed
+#endif
+} slot_t;
+
+#ifndef _WIN32
+static int cmp_str(const void *a, const void *b) {
+  const char *const *x = a;
+  const char *const *y = b;
+  return strcmp(*x, *y);
+}
+
+static bool is_graph_file(const char *name) {
+  const char *dot = strrchr(name, '.');
+  return dot != NULL && (strcmp(dot, ".gv") == 0 || strcmp(dot, ".dot") == 0);
+}
+
+/// append the graph files in `dir` to `files`, in sorted order
+static void expand_dir(const char *dir, char ***files, size_t *n_files,
+                       size_t *capacity) {
+  DIR *d = opendir(dir);
+  if (d == NULL) {
+    fprintf(stderr, "can't open directory %s: %s\n", dir, strerror(errno));
+    return;
+  }
+  const size_t first = *n_files;
+  for (struct dirent *entry; (entry = readdir(d)) != NULL;) {
+    if (!is_graph_file(entry->d_name)) {
+      continue;
+    }
+    if (*n_files + 1 >= *capacity) {
+      const size_t c = *capacity == 0 ? 16 : 2 * *capacity;
+      *files = gv_recalloc(*files, *capacity, c, sizeof(char *));
+      *capacity = c;
+    }
+    agxbuf path = {0};
+    agxbprint(&path, "%s/%s", dir, entry->d_name);
+    (*files)[(*n_files)++] = agxbdisown(&path);
+  }
+  closedir(d);
+  qsort(*files + first, *n_files - first, sizeof(char *), cmp_str);
+}
+
+static bool is_dir(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+#endif
+
+/// is `arg` the `-j` flag, `-j` or `-j<digits>`?
+static bool is_jobs_flag(const char *arg) {
+  if (!startswith(arg, "-j")) {
+    return false;
+  }
+  for (const char *p = arg + 2; *p != '\0'; ++p) {
+    if (!isdigit((int)*p)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int batch_args(int *argc, char ***argv, size_t *jobs) {
+  char **args = *argv;
+  bool batch = false;
+  bool has_jobs = false;
+  int n = 1;
+
+  *jobs = 1;
+  for (int i = 1; i < *argc; ++i) {
+    if (strcmp(args[i], "--batch") == 0) {
+      batch = true;
+    } else if (is_jobs_flag(args[i])) {
+      const char *rest = args[i] + 2;
+      if (*rest == '\0') {
+#ifdef _SC_NPROCESSORS_ONLN
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        *jobs = cpus > 0 ? (size_t)cpus : 1;
+#endif
+      } else {
+        char *end;
+        const long v = strtol(rest, &end, 10);
+        if (*end != '\0' || v <= 0) {
+          fprintf(stderr, "Invalid parameter \"%s\" for -j flag\n", rest);
+          return -1;
+        }
+        *jobs = (size_t)v;
+      }
+      has_jobs = true;
+    } else {
+      args[n++] = args[i];
+    }
+  }
+  args[n] = NULL;
+  *argc = n;
+
+  if (has_jobs && !batch) {
+    fprintf(stderr, "The -j flag requires --batch\n");
+    return -1;
+  }
+  if (!batch) {
+    return 0;
+  }
+
+  for (int i = 1; i < *argc; ++i) {
+    // all graphs would be written to the same file by concurrent workers
+    if (startswith(args[i], "-o")) {
+      fprintf(stderr, "--batch cannot be combined with -o; use -O to write "
+                      "each graph to its own file\n");
+      return -1;
+    }
+  }
+
+#ifndef _WIN32
+  bool any_dir = false;
+  for (int i = 1; i < *argc && !any_dir; ++i) {
+    any_dir = args[i][0] != '-' && is_dir(args[i]);
+  }
+  if (any_dir) {
+    char **expanded = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    for (int i = 0; i < *argc; ++i) {
+      if (i > 0 && args[i][0] != '-' && is_dir(args[i])) {
+        expand_dir(args[i], &expanded, &size, &capacity);
+        continue;
+      }
+      if (size + 1 >= capacity) {
+        const size_t c = capacity == 0 ? 16 : 2 * capacity;
+        expanded = gv_recalloc(expanded, capacity, c, sizeof(char *));
+        capacity = c;
+      }
+      expanded[size++] = gv_strdup(args[i]);
+    }
+    expanded[size] = NULL;
+    *argv = expanded;
+    *argc = (int)size;
+  }
+#endif
+
+  return 1;
+}
+
+void batch_args_free(int argc, char **argv) {
+  for (int i = 0; i < argc; ++i) {
+    free(argv[i]);
+  }
+  free(argv);
+}
+
+/// messages of the graph being read, see @ref read_graph
+static agxbuf *read_messages;
+
+static int capture_message(char *message) {
+  agxbput(read_messages, message);
+  return 0;
+}
+
+/// read the next input graph, collecting the diagnostics of reading in `err`
+///
+/// A stream that cannot be read, because of a syntax error or because its file
+/// cannot be opened, is abandoned and reading goes on with the next one.
+///
+/// @param failed [out] Whether reading reported an error. The graph returned,
+///   if any, is then from a later stream.
+/// @return The next graph or NULL if there are no more
+static graph_t *read_graph(GVC_t *gvc, agxbuf *err, bool *failed) {
+  (void)agreseterrors();
+  read_messages = err;
+  const agusererrf previous = agseterrf(capture_message);
+  graph_t *g = gvNextInputGraph(gvc);
+  (void)agseterrf(previous);
+  read_messages = NULL;
+  *failed = agreseterrors() > 0;
+  return g;
+}
+
+/// lay out and render a graph with the jobs given on the command line
+static int process(GVC_t *gvc, graph_t *g) {
+  int rc = 0;
+  if (gvLayoutJobs(gvc, g) != 0 || gvRenderJobs(gvc, g) != 0) {
+    rc = 1;
+  }
+  const int errors = agreseterrors();
+  return errors > rc ? errors : rc;
+}
+
+/// write the result of a graph and release its buffers
+static void emit(slot_t *slot, size_t index, const char *cmdname) {
+  const size_t len = agxblen(&slot->out);
+  printf("graph %zu %d %zu\n", index, slot->status, len);
+  fwrite(agxbuse(&slot->out), 1, len, stdout);
+  fflush(stdout);
+
+  for (const char *line = agxbuse(&slot->err); *line != '\0';) {
+    const char *eol = strchr(line, '\n');
+    const size_t line_len = eol == NULL ? strlen(line) : (size_t)(eol - line);
+    fprintf(stderr, "%s: graph %zu: %.*s\n", cmdname, index, (int)line_len,
+            line);
+    line += line_len + (eol != NULL);
+  }
+
+  agxbfree(&slot->out);
+  agxbfree(&slot->err);
+  slot->state = SLOT_FREE;
+}
+
+#ifdef _WIN32
+/// process a graph in this process, capturing its output
+static void run_inline(GVC_t *gvc, graph_t *g, slot_t *slot) {
+  FILE *tmp = tmpfile();
+  if (tmp == NULL) {
+    agxbprint(&slot->err, "can't create temporary file: %s", strerror(errno));
+    slot->status = 1;
+    slot->state = SLOT_DONE;
+    return;
+  }
+
+  fflush(stdout);
+  const int saved = _dup(_fileno(stdout));
+  _dup2(_fileno(tmp), _fileno(stdout));
+  slot->status = process(gvc, g);
+  fflush(stdout);
+  _dup2(saved, _fileno(stdout));
+  _close(saved);
+
+  rewind(tmp);
+  char buf[BUFSIZ];
+  for (size_t r; (r = fread(buf, 1, sizeof(buf), tmp)) > 0;) {
+    agxbput_n(&slot->out, buf, r);
+  }
+  fclose(tmp);
+  gvFreeLayout(gvc, g);
+  slot->state = SLOT_DONE;
+}
+#else
+/// process a graph in a child process
+///
+/// The child inherits the loaded plugins and the parsed graph, so nothing is
+/// set up twice. Its output is collected through pipes by @ref wait_workers.
+static void spawn(GVC_t *gvc, graph_t *g, slot_t *slot) {
+  int out[2], err[2];
+  if (pipe(out) != 0) {
+    agxbprint(&slot->err, "can't create pipe: %s", strerror(errno));
+    slot->status = 1;
+    slot->state = SLOT_DONE;
+    return;
+  }
+  if (pipe(err) != 0) {
+    agxbprint(&slot->err, "can't create pipe: %s", strerror(errno));
+    close(out[0]);
+    close(out[1]);
+    slot->status = 1;
+    slot->state = SLOT_DONE;
+    return;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  const pid_t pid = fork();
+  if (pid < 0) {
+    agxbprint(&slot->err, "can't start worker: %s", strerror(errno));
+    close(out[0]);
+    close(out[1]);
+    close(err[0]);
+    close(err[1]);
+    slot->status = 1;
+    slot->state = SLOT_DONE;
+    return;
+  }
+
+  if (pid == 0) {
+    close(out[0]);
+    close(err[0]);
+    dup2(out[1], STDOUT_FILENO);
+    dup2(err[1], STDERR_FILENO);
+    close(out[1]);
+    close(err[1]);
+    const int rc = process(gvc, g);
+    fflush(stdout);
+    fflush(stderr);
+    // skip exit handlers, which could disturb the input stream shared with the
+    // parent
+    _exit(rc);
+  }
+
+  close(out[1]);
+  close(err[1]);
+  slot->pid = pid;
+  slot->out_fd = out[0];
+  slot->err_fd = err[0];
+  slot->state = SLOT_RUNNING;
+}
+
+/// read what is available from `*fd` into `buf`, closing it on end of file
+static void drain(int *fd, agxbuf *buf) {
+  char chunk[BUFSIZ];
+  const ssize_t r = read(*fd, chunk, sizeof(chunk));
+  if (r > 0) {
+    agxbput_n(buf, chunk, (size_t)r);
+  } else if (r == 0 || errno != EINTR) {
+    close(*fd);
+    *fd = -1;
+  }
+}
+
+/// record how a finished worker exited and mark its slot done
+static void reap(slot_t *slot) {
+  int st;
+  while (waitpid(slot->pid, &st, 0) < 0 && errno == EINTR)
+    ;
+  if (WIFEXITED(st)) {
+    slot->status = WEXITSTATUS(st);
+  } else {
+    if (WIFSIGNALED(st)) {
+      agxbprint(&slot->err, "worker terminated by signal %d\n", WTERMSIG(st));
+    }
+    slot->status = 1;
+  }
+  slot->state = SLOT_DONE;
+}
+
+/// give up on all running workers, after their output can no longer be
+/// collected
+///
+/// @return Number of workers stopped
+static size_t abandon_workers(slot_t *slots, size_t n_slots, int error) {
+  size_t stopped = 0;
+  for (size_t i = 0; i < n_slots; ++i) {
+    slot_t *slot = &slots[i];
+    if (slot->state != SLOT_RUNNING) {
+      continue;
+    }
+    agxbprint(&slot->err, "can't collect worker output: %s\n", strerror(error));
+    kill(slot->pid, SIGKILL);
+    if (slot->out_fd >= 0) {
+      close(slot->out_fd);
+      slot->out_fd = -1;
+    }
+    if (slot->err_fd >= 0) {
+      close(slot->err_fd);
+      slot->err_fd = -1;
+    }
+    reap(slot);
+    slot->status = 1;
+    ++stopped;
+  }
+  return stopped;
+}
+
+/// collect output from running workers until at least one finishes
+///
+/// If waiting fails, every running worker is stopped and given an error
+/// result, so the batch can still account for all of its graphs.
+///
+/// @return Number of workers that finished
+static size_t wait_workers(slot_t *slots, size_t n_slots) {
+  struct pollfd *fds = gv_calloc(2 * n_slots, sizeof(struct pollfd));
+  size_t finished = 0;
+
+  while (finished == 0) {
+    size_t n_fds = 0;
+    for (size_t i = 0; i < n_slots; ++i) {
+      if (slots[i].state != SLOT_RUNNING) {
+        continue;
+      }
+      if (slots[i].out_fd >= 0) {
+        fds[n_fds++] = (struct pollfd){.fd = slots[i].out_fd, .events = POLLIN};
+      }
+      if (slots[i].err_fd >= 0) {
+        fds[n_fds++] = (struct pollfd){.fd = slots[i].err_fd, .events = POLLIN};
+      }
+    }
+
+    if (n_fds > 0 && poll(fds, (nfds_t)n_fds, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      finished = abandon_workers(slots, n_slots, errno);
+      break;
+    }
+
+    for (size_t i = 0; i < n_slots; ++i) {
+      slot_t *slot = &slots[i];
+      if (slot->state != SLOT_RUNNING) {
+        continue;
+      }
+      for (size_t j = 0; j < n_fds; ++j) {
+        if (fds[j].revents == 0) {
+          continue;
+        }
+        if (fds[j].fd == slot->out_fd) {
+          drain(&slot->out_fd, &slot->out);
+        } else if (fds[j].fd == slot->err_fd) {
+          drain(&slot->err_fd, &slot->err);
+        }
+      }
+      if (slot->out_fd >= 0 || slot->err_fd >= 0) {
+        continue;
+      }
+
+      reap(slot);
+      ++finished;
+    }
+  }
+
+  free(fds);
+  return finished;
+}
+#endif
+
+int batch_run(GVC_t *gvc, size_t jobs) {
+  // Graphs that finish ahead of an earlier, slower one are held back so output
+  // stays in input order. Bound how far ahead we let workers get.
+  const size_t n_slots = 2 * jobs;
+  slot_t *slots = gv_calloc(n_slots, sizeof(slot_t));
+
+  size_t next_input = 0;
+  size_t next_output = 0;
+  size_t running = 0;
+  bool eof = false;
+  graph_t *pending = NULL; ///< graph read along with a failed stream
+  int rc = 0;
+
+  while (true) {
+    while (!eof && running < jobs && next_input < next_output + n_slots) {
+      slot_t *slot = &slots[next_input % n_slots];
+      *slot = (slot_t){.state = SLOT_FREE};
+      graph_t *g = pending;
+      pending = NULL;
+      if (g == NULL) {
+        bool failed;
+        g = read_graph(gvc, &slot->err, &failed);
+        if (failed) {
+          // the unreadable input takes an index of its own, with an empty
+          // result, so its error is framed and counted like any other
+          slot->status = 1;
+          slot->state = SLOT_DONE;
+          ++next_input;
+          pending = g;
+          eof = g == NULL;
+          continue;
+        }
+        if (g == NULL) {
+          eof = true;
+          break;
+        }
+      }
+#ifdef _WIN32
+      run_inline(gvc, g, slot);
+#else
+      spawn(gvc, g, slot);
+      if (slot->state == SLOT_RUNNING) {
+        ++running;
+      }
+#endif
+      agclose(g);
+      ++next_input;
+    }
+
+    while (next_output < next_input &&
+           slots[next_output % n_slots].state == SLOT_DONE) {
+      slot_t *slot = &slots[next_output % n_slots];
+      rc = slot->status > rc ? slot->status : rc;
+      emit(slot, next_output, CmdName);
+      ++next_output;
+    }
+
+    if (eof && next_output == next_input) {
+      break;
+    }
+
+#ifndef _WIN32
+    if (running > 0) {
+      running -= wait_workers(slots, n_slots);
+    }
+#endif
+  }
+
+  free(slots);
+  return rc;
+}
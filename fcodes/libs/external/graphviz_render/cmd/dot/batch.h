@@ -0,0 +1,61 @@
+/**
+ * @file
+ * @brief `--batch` mode of the dot command
+ *
+ * In batch mode, the plugins and command line are set up once and every input
+ * graph is laid out and rendered by a pool of workers. Results are written to
+ * stdout in input order, each preceded by a header line
+ *
+ *   graph <index> <status> <length>
+ *
+ * where `<index>` counts input graphs from 0, `<status>` is 0 if the graph was
+ * processed without errors and `<length>` is the number of bytes of output that
+ * follow. Diagnostics of a graph are written to stderr, prefixed with its
+ * index. An error in one graph does not stop the batch. An input that cannot be
+ * read, like a stream with a syntax error, gets a result of its own with a
+ * non-zero status and no output.
+ */
+
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#pragma once
+
+#include <gvc/gvc.h>
+#include <stddef.h>
+
+/** strip batch mode options from the command line
+ *
+ * Removes `--batch` and `-j[N]` from `argv`, updating `argc`. In batch mode,
+ * directory arguments are replaced by the `.gv` and `.dot` files they contain,
+ * in which case `argv` is replaced by a newly allocated array, to be released
+ * with @ref batch_args_free.
+ *
+ * @param argc [in,out] Number of command line arguments
+ * @param argv [in,out] Command line arguments
+ * @param jobs [out] Number of workers requested with `-j`
+ * @return 1 if batch mode was requested, 0 if not, -1 on a usage error
+ */
+int batch_args(int *argc, char ***argv, size_t *jobs);
+
+/** release a command line allocated by @ref batch_args
+ *
+ * @param argc Number of command line arguments
+ * @param argv Command line arguments, with the arguments themselves
+ */
+void batch_args_free(int argc, char **argv);
+
+/** lay out and render all input graphs
+ *
+ * @param gvc Context with plugins loaded and command line parsed
+ * @param jobs Maximum number of graphs to process at once
+ * @return The highest status of any graph
+ */
+int batch_run(GVC_t *gvc, size_t jobs);
@@ -19,6 +19,7 @@
 
 #include "config.h"
 
+#include "batch.h"
 #include <cgraph/cgraph.h>
 #include <cgraph/exit.h>
 #include <gvc/gvc.h>
@@ -48,6 +49,12 @@ int main(int argc, char **argv)
 {
     graph_t *prev = NULL;
     int r, rc = 0;
+    size_t jobs;
+    char **const original_argv = argv;
+
+    const int batch = batch_args(&argc, &argv, &jobs);
+    if (batch < 0)
+	graphviz_exit(1);
 
     Gvc = gvContextPlugins(lt_preloaded_symbols, DEMAND_LOADING);
     GvExitOnUsage = 1;
@@ -63,6 +70,9 @@ int main(int argc, char **argv)
         // TODO: fully remove `MemTest` and associated `-m` parsing in future
         fprintf(stderr, "The -m command-line option is no longer supported.\n");
     }
+    else if (batch) {
+	rc = batch_run(Gvc, jobs);
+    }
     else if ((G = gvPluginsGraph(Gvc))) {
 	    gvLayoutJobs(Gvc, G);  /* take layout engine from command line */
 	    gvRenderJobs(Gvc, G);
@@ -82,6 +92,8 @@ int main(int argc, char **argv)
     }
     gvFinalize(Gvc);
     r = gvFreeContext(Gvc);
+    if (argv != original_argv)
+	batch_args_free(argc, argv);
     graphviz_exit(MAX(rc,r));
 }
 
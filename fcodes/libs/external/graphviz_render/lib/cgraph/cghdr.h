@@ -88,6 +88,13 @@ void *agdictobjmem(Dict_t * dict, void * p, size_t size,
 		   Dtdisc_t * disc);
 void agdictobjfree(void *p, Dtdisc_t *disc);
 
+	/* arena storage of a root graph, see mem.c */
+typedef struct Agarena_s Agarena_t;
+Agarena_t *agarena_open(void);
+void agarena_close(Agarena_t *arena);
+void agarena_adddict(Agraph_t *g, Dict_t *dict);
+void agarena_deldict(Agraph_t *g, Dict_t *dict);
+
 	/* name-value pair operations */
 CGHDR_API Agdatadict_t *agdatadict(Agraph_t *g, bool cflag);
 CGHDR_API Agattr_t *agattrrec(void *obj);
@@ -250,6 +250,7 @@ struct Agdesc_s {		/* graph descriptor */
     unsigned no_write:1;	/* if a temporary subgraph */
     unsigned has_attrs:1;	/* if string attr tables should be initialized */
     unsigned has_cmpnd:1;	/* if may contain collapsed nodes */
+    unsigned arena:1;		/* if storage is released with the root graph */
 };
 /// @}
 
@@ -330,6 +331,7 @@ struct Agclos_s {
     Agcbstack_t *cb;		/* user and system callback function stacks */
     Dict_t *lookup_by_name[3];
     Dict_t *lookup_by_id[3];
+    struct Agarena_s *arena;	/* storage of an arena graph, else NULL */
 };
 
 struct Agraph_s {
@@ -355,6 +357,7 @@ CGRAPH_API Agraph_t *agmemread(const char *cp);
 CGRAPH_API Agraph_t *agmemconcat(Agraph_t *g, const char *cp);
 CGRAPH_API void agreadline(int);
 CGRAPH_API void agsetfile(const char *);
+CGRAPH_API void agreadarena(int);
 CGRAPH_API Agraph_t *agconcat(Agraph_t * g, void *chan, Agdisc_t * disc);
 CGRAPH_API int agwrite(Agraph_t * g, void *chan);
 CGRAPH_API int agisdirected(Agraph_t * g);
@@ -520,6 +523,14 @@ CGRAPH_API int agcountuniqedges(Agraph_t * g, Agnode_t * n, int in, int out);
 /// @}
 
 /// @defgroup cgmem memory
+///
+/// The storage of a graph opened with `Agdesc_t.arena` set (or read after
+/// `agreadarena(1)`) comes from large blocks owned by its root graph. Objects
+/// are laid out contiguously in creation order, `agfree` of a single object
+/// returns nothing to the system, and `agclose` of the root graph releases
+/// everything at once instead of deleting each node and edge. This suits
+/// graphs that are built, laid out and thrown away, rather than ones that are
+/// edited for a long time.
 /// @{
 CGRAPH_API void *agalloc(Agraph_t * g, size_t size);
 CGRAPH_API void *agrealloc(Agraph_t * g, void *ptr, size_t oldsize,
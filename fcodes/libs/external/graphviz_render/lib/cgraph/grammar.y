@@ -81,6 +81,7 @@ static void closesubg(void);
 static Agraph_t *G;				/* top level graph */
 static	Agdisc_t	*Disc;		/* discipline passed to agread or agconcat */
 static gstack_t *S;
+static bool Arena;			/* if graphs read get arena storage */
 
 %}
 
@@ -517,7 +518,8 @@ static void startgraph(char *name, bool directed, bool strict)
 {
 	if (G == NULL) {
 		SubgraphDepth = 0;
-		Agdesc_t req = {.directed = directed, .strict = strict, .maingraph = true};
+		Agdesc_t req = {.directed = directed, .strict = strict, .maingraph = true,
+		                .arena = Arena};
 		Ag_G_global = G = agopen(name,req,Disc);
 	}
 	else {
@@ -576,3 +578,6 @@ Agraph_t *agconcat(Agraph_t *g, void *chan, Agdisc_t *disc)
 
 Agraph_t *agread(void *fp, Agdisc_t *disc) {return agconcat(NULL,fp,disc); }
 
+/* Give graphs read from now on arena storage (see agalloc), or not. */
+void agreadarena(int flag) { Arena = flag != 0; }
+
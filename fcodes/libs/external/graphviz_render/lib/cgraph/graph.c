@@ -41,6 +41,8 @@ Agraph_t *agopen(char *name, Agdesc_t desc, Agdisc_t * arg_disc)
     IDTYPE gid;
 
     clos = agclos(arg_disc);
+    if (desc.arena)
+	clos->arena = agarena_open();
     g = gv_calloc(1, sizeof(Agraph_t));
     AGTYPE(g) = AGRAPH;
     g->clos = clos;
@@ -81,6 +83,25 @@ Agraph_t *agopen1(Agraph_t * g)
     return g;
 }
 
+/*
+ * Release an arena graph in one step. Objects are not deleted one by one, so
+ * this is only done when nobody can observe the difference: no callbacks are
+ * registered and IDs come from the default discipline, whose per-object
+ * state lives in the arena too.
+ */
+static bool agclose_arena(Agraph_t * g)
+{
+    Agclos_t *clos = g->clos;
+
+    if (clos->arena == NULL || clos->cb || clos->disc.id != &AgIdDisc)
+	return false;
+    clos->disc.id->close(clos->state.id);
+    agarena_close(clos->arena);
+    free(g);
+    free(clos);
+    return true;
+}
+
 /*
  * Close a graph or subgraph, freeing its storage.
  */
@@ -90,6 +111,8 @@ int agclose(Agraph_t * g)
     Agnode_t *n, *next_n;
 
     par = agparent(g);
+    if (par == NULL && agclose_arena(g))
+	return SUCCESS;
 
     for (subg = agfstsubg(g); subg; subg = next_subg) {
 	next_subg = agnxtsubg(subg);
@@ -132,6 +155,7 @@ int agclose(Agraph_t * g)
 	AGDISC(g, id)->close(AGCLOS(g, id));
 	if (agstrclose(g)) return FAILURE;
 	clos = g->clos;
+	agarena_close(g->clos->arena);
 	free(g);
 	free(clos);
     }
@@ -191,13 +191,14 @@ void aginternalmapclearlocalnames(Agraph_t * g)
     }
 }
 
-static void closeit(Dict_t ** d)
+/* the maps were opened by agdtopen, so their storage may be g's arena */
+static void closeit(Agraph_t * g, Dict_t ** d)
 {
     int i;
 
     for (i = 0; i < 3; i++) {
 	if (d[i]) {
-	    dtclose(d[i]);
+	    agdtclose(g, d[i]);
 	    d[i] = NULL;
 	}
     }
@@ -206,6 +207,6 @@ static void closeit(Dict_t ** d)
 void aginternalmapclose(Agraph_t * g)
 {
     Ag_G_global = g;
-    closeit(g->clos->lookup_by_name);
-    closeit(g->clos->lookup_by_id);
+    closeit(g, g->clos->lookup_by_name);
+    closeit(g, g->clos->lookup_by_id);
 }
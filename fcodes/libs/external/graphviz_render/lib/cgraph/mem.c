@@ -8,14 +8,241 @@
  * Contributors: Details at https://graphviz.org
  *************************************************************************/
 
+#include <cgraph/alloc.h>
 #include <cgraph/cghdr.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
-void *agalloc(Agraph_t * g, size_t size)
+/*
+ * Arena storage.
+ *
+ * A root graph opened with desc.arena set carries the blocks its objects,
+ * records, attribute arrays, strings and dictionaries are carved from.
+ * Allocation bumps a pointer through the current block. agfree of arena
+ * memory is a no-op, except that agrealloc recycles the old copy of a grown
+ * array for later allocations of the same size. Closing the root graph
+ * releases the blocks and the dictionaries opened on them, without visiting
+ * the objects.
+ */
+
+/// sizes are rounded up to this, so allocations keep the alignment of malloc
+#define ARENA_ALIGN 16
+
+/// size of the first block; later ones double up to ARENA_BLOCK_MAX
+#define ARENA_BLOCK_MIN (16 * 1024)
+#define ARENA_BLOCK_MAX (1024 * 1024)
+
+/// largest size whose memory is recycled after agrealloc moves it
+#define ARENA_RECYCLE_MAX 512
+
+typedef struct {
+    uintptr_t base;
+    size_t size;
+} arena_block_t;
+
+/// a dictionary to free with the arena, linked through its user field
+typedef struct arena_dict_s {
+    Dict_t *dict;
+    struct arena_dict_s *prev, *next;
+} arena_dict_t;
+
+struct Agarena_s {
+    arena_block_t *blocks;	/* ordered by address, for agfree */
+    size_t n_blocks;
+    size_t capacity;
+    char *next;			/* free space of the current block */
+    char *end;
+    size_t block_size;		/* size of the next block */
+    void *recycled[ARENA_RECYCLE_MAX / ARENA_ALIGN + 1]; /* by size class */
+    arena_dict_t *dicts;
+};
+
+static size_t arena_round(size_t size)
+{
+    if (size == 0)
+	size = 1;
+    return (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+}
+
+/// position of the first block starting after p
+static size_t arena_find(const Agarena_t *arena, uintptr_t p)
+{
+    size_t lo = 0, hi = arena->n_blocks;
+    while (lo < hi) {
+	size_t mid = lo + (hi - lo) / 2;
+	if (arena->blocks[mid].base <= p)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+static bool arena_owns(const Agarena_t *arena, const void *ptr)
+{
+    uintptr_t p = (uintptr_t)ptr;
+    size_t i = arena_find(arena, p);
+    return i > 0 && p - arena->blocks[i - 1].base < arena->blocks[i - 1].size;
+}
+
+/// allocate a zeroed block and enter it in the address order
+static char *arena_block(Agarena_t *arena, size_t size)
+{
+    char *base = calloc(1, size);
+    if (base == NULL)
+	return NULL;
+    if (arena->n_blocks == arena->capacity) {
+	size_t capacity = arena->capacity ? 2 * arena->capacity : 16;
+	arena_block_t *blocks = realloc(arena->blocks,
+					capacity * sizeof(arena_block_t));
+	if (blocks == NULL) {
+	    free(base);
+	    return NULL;
+	}
+	arena->blocks = blocks;
+	arena->capacity = capacity;
+    }
+    size_t i = arena_find(arena, (uintptr_t)base);
+    memmove(&arena->blocks[i + 1], &arena->blocks[i],
+	    (arena->n_blocks - i) * sizeof(arena_block_t));
+    arena->blocks[i] = (arena_block_t){.base = (uintptr_t)base, .size = size};
+    ++arena->n_blocks;
+    return base;
+}
+
+static void *arena_alloc(Agarena_t *arena, size_t size)
 {
-    (void)g;
+    size = arena_round(size);
+
+    if (size <= ARENA_RECYCLE_MAX) {
+	void **head = &arena->recycled[size / ARENA_ALIGN];
+	if (*head) {
+	    void *mem = *head;
+	    *head = *(void **)mem;
+	    memset(mem, 0, size);
+	    return mem;
+	}
+    }
+
+    if ((size_t)(arena->end - arena->next) < size) {
+	/* big requests get a block of their own, so the current one is not
+	   abandoned half used */
+	if (size > arena->block_size / 2)
+	    return arena_block(arena, size);
+	char *base = arena_block(arena, arena->block_size);
+	if (base == NULL)
+	    return NULL;
+	arena->next = base;
+	arena->end = base + arena->block_size;
+	if (arena->block_size < ARENA_BLOCK_MAX)
+	    arena->block_size *= 2;
+    }
+
+    void *mem = arena->next;
+    arena->next += size;
+    return mem;
+}
 
-    void *mem = calloc(1, size);
+static void arena_recycle(Agarena_t *arena, void *ptr, size_t size)
+{
+    size = arena_round(size);
+    if (size <= ARENA_RECYCLE_MAX) {
+	void **head = &arena->recycled[size / ARENA_ALIGN];
+	*(void **)ptr = *head;
+	*head = ptr;
+    }
+}
+
+static void *arena_realloc(Agarena_t *arena, void *ptr, size_t oldsize,
+			   size_t size)
+{
+    size_t have = arena_round(oldsize);
+    size_t want = arena_round(size);
+    char *p = ptr;
+
+    if (want <= have)
+	return ptr;
+
+    /* the last allocation of the current block can grow in place */
+    if (p + have == arena->next && (size_t)(arena->end - p) >= want) {
+	arena->next = p + want;
+	memset(p + oldsize, 0, size - oldsize);
+	return ptr;
+    }
+
+    void *mem = arena_alloc(arena, size);
+    if (mem != NULL) {
+	memcpy(mem, ptr, oldsize);
+	arena_recycle(arena, ptr, oldsize);
+    }
+    return mem;
+}
+
+Agarena_t *agarena_open(void)
+{
+    Agarena_t *arena = gv_alloc(sizeof(Agarena_t));
+    arena->block_size = ARENA_BLOCK_MIN;
+    return arena;
+}
+
+void agarena_close(Agarena_t *arena)
+{
+    if (arena == NULL)
+	return;
+    /* dictionary headers are allocated by cdt itself */
+    for (arena_dict_t *d = arena->dicts; d; d = d->next)
+	free(d->dict);
+    for (size_t i = 0; i < arena->n_blocks; ++i)
+	free((void *)arena->blocks[i].base);
+    free(arena->blocks);
+    free(arena);
+}
+
+void agarena_adddict(Agraph_t *g, Dict_t *dict)
+{
+    Agarena_t *arena = g->clos->arena;
+    if (arena == NULL || dict == NULL)
+	return;
+    arena_dict_t *d = arena_alloc(arena, sizeof(arena_dict_t));
+    if (d == NULL)
+	return;
+    d->dict = dict;
+    d->next = arena->dicts;
+    if (d->next)
+	d->next->prev = d;
+    arena->dicts = d;
+    dict->user = d;
+}
+
+void agarena_deldict(Agraph_t *g, Dict_t *dict)
+{
+    Agarena_t *arena = g->clos->arena;
+    arena_dict_t *d = dict->user;
+    if (arena == NULL || d == NULL)
+	return;
+    if (d->prev)
+	d->prev->next = d->next;
+    else
+	arena->dicts = d->next;
+    if (d->next)
+	d->next->prev = d->prev;
+    dict->user = NULL;
+    arena_recycle(arena, d, sizeof(arena_dict_t));
+}
+
+/// the arena of g, if it has one
+static Agarena_t *arenaof(Agraph_t *g)
+{
+    return g && g->clos ? g->clos->arena : NULL;
+}
+
+void *agalloc(Agraph_t * g, size_t size)
+{
+    Agarena_t *arena = arenaof(g);
+    void *mem = arena ? arena_alloc(arena, size) : calloc(1, size);
     if (mem == NULL)
 	 agerr(AGERR,"memory allocation failure");
     return mem;
@@ -24,10 +251,13 @@ void *agalloc(Agraph_t * g, size_t size)
 void *agrealloc(Agraph_t * g, void *ptr, size_t oldsize, size_t size)
 {
     void *mem;
+    Agarena_t *arena = arenaof(g);
 
     if (size > 0) {
 	if (ptr == 0)
 	    mem = agalloc(g, size);
+	else if (arena && arena_owns(arena, ptr))
+	    mem = arena_realloc(arena, ptr, oldsize, size);
 	else {
 	    mem = realloc(ptr, size);
 	    if (mem != NULL && size > oldsize) {
@@ -43,8 +273,9 @@ void *agrealloc(Agraph_t * g, void *ptr, size_t oldsize, size_t size)
 
 void agfree(Agraph_t * g, void *ptr)
 {
-    (void)g;
+    Agarena_t *arena = arenaof(g);
 
-    if (ptr)
+    /* arena memory is released with the root graph */
+    if (ptr && !(arena && arena_owns(arena, ptr)))
 	free(ptr);
 }
@@ -57,6 +57,8 @@ Dict_t *agdtopen(Agraph_t * g, Dtdisc_t * disc, Dtmethod_t * method)
     d = dtopen(disc, method);
     disc->memoryf = memf;
     Ag_dictop_G = NULL;
+    if (g)
+	agarena_adddict(g, d);
     return d;
 }
 
@@ -75,8 +77,13 @@ int agdtclose(Agraph_t * g, Dict_t * dict)
     memf = disc->memoryf;
     disc->memoryf = agdictobjmem;
     Ag_dictop_G = g;
-    if (dtclose(dict))
+    if (g)
+	agarena_deldict(g, dict);
+    if (dtclose(dict)) {
+	if (g)
+	    agarena_adddict(g, dict);
 	return 1;
+    }
     disc->memoryf = memf;
     Ag_dictop_G = NULL;
     return 0;
@@ -28,6 +28,7 @@
 #include <cgraph/list.h>
 #include <cgraph/unreachable.h>
 #include <common/htmltable.h>
+#include <common/profile.h>
 #include <gvc/gvc.h>
 #include <cdt/cdt.h>
 #include <pathplan/pathgeom.h>
@@ -3941,7 +3942,14 @@ void gv_fixLocale (int set)
 }
 
 
-#define FINISH() if (Verbose) fprintf(stderr,"gvRenderJobs %s: %.2f secs.\n", agnameof(g), elapsed_sec())
+#define FINISH() \
+    do { \
+	if (Verbose) \
+	    fprintf(stderr,"gvRenderJobs %s: %.2f secs.\n", agnameof(g), elapsed_sec()); \
+	gv_span_end(); \
+	if (profiled) \
+	    gv_profile_finish(gvc); \
+    } while (0)
 
 int gvRenderJobs (GVC_t * gvc, graph_t * g)
 {
@@ -3950,6 +3958,8 @@ int gvRenderJobs (GVC_t * gvc, graph_t * g)
 
     if (Verbose)
 	start_timer();
+    const bool profiled = gv_profile_start(gvc, g);
+    gv_span_begin("gvRenderJobs");
     
     if (!LAYOUT_DONE(g)) {
         agerr (AGERR, "Layout was not done.  Missing layout plugins? \n");
@@ -4008,7 +4018,9 @@ int gvRenderJobs (GVC_t * gvc, graph_t * g)
 	    if (! (firstjob->flags & GVDEVICE_DOES_PAGES)
 	      || strcmp(job->output_langname, firstjob->output_langname)) {
 
+	        gv_span_begin("gvrender_end_job");
 	        gvrender_end_job(firstjob);
+	        gv_span_end();
 	    
             	gvc->active_jobs = NULL; /* clear active list */
 	    	gvc->common.viewNum = 0;
@@ -4045,7 +4057,9 @@ int gvRenderJobs (GVC_t * gvc, graph_t * g)
 	    show_boxes_append(&Show_boxes, NULL);
 	    job->common->show_boxes = Show_boxes.data;
 #endif
+	    gv_span_begin("emit_graph");
 	    emit_graph(job, g);
+	    gv_span_end();
 	}
 
         /* the last job, after all input graphs are processed,
@@ -176,12 +176,16 @@ emit_htextspans(GVJ_t *job, size_t nspans, htextspan_t *spans, pointf p,
 		tl.yoffset_centerline = 1;
 	    tl.font->postscript_alias = ti->font->postscript_alias;
 	    tl.layout = ti->layout;
+	    tl.free_layout = ti->free_layout;
 	    tl.size.x = ti->size.x;
 	    tl.size.y = spans[i].lfsize;
 	    tl.just = 'l';
 
 	    p_.x = p.x;
 	    gvrender_textspan(job, p_, &tl);
+	    /* keep a layout the renderer made, to be freed with the item */
+	    ti->layout = tl.layout;
+	    ti->free_layout = tl.free_layout;
 	    p.x += ti->size.x;
 	    ti++;
 	}
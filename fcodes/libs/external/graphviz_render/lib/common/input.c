@@ -11,6 +11,7 @@
 #include <ctype.h>
 #include <common/render.h>
 #include <common/htmltable.h>
+#include <common/profile.h>
 #include <errno.h>
 #include <gvc/gvc.h>
 #include <xdot/xdot.h>
@@ -40,7 +41,15 @@ static char *genericItems = "\n\
  -P          - Internally generate a graph of the current plugins. \n\
  -q[l]       - Set level of message suppression (=1)\n\
  -s[v]       - Scale input by 'v' (=72)\n\
- -y          - Invert y coordinate in output\n";
+ -y          - Invert y coordinate in output\n\
+ --batch     - Lay out and render each input graph independently, framing\n\
+               results on stdout\n\
+ -j[v]       - Process up to 'v' graphs at once in batch mode (=processors)\n\
+ --arena     - Allocate each input graph from blocks freed all at once\n\
+ --profile[=file] - Write timings and counters of each graph's layout and\n\
+               render as JSON lines to 'file' (=stderr)\n\
+ --no-text-cache - Measure every text label instead of reusing the sizes of\n\
+               identical ones\n";
 
 static char *neatoFlags =
     "(additional options for neato)    [-x] [-n<v>]\n";
@@ -276,6 +285,24 @@ int dotneato_args_initialize(GVC_t * gvc, int argc, char **argv)
 	} else if (argv[i] &&
 	    (startswith(argv[i], "-?") || strcmp(argv[i], "--help") == 0)) {
 	    return dotneato_usage(0);
+	} else if (argv[i] && strcmp(argv[i], "--arena") == 0) {
+	    agreadarena(1);
+	} else if (argv[i] && strcmp(argv[i], "--no-text-cache") == 0) {
+	    textspan_cache_enable(gvc, false);
+	} else if (argv[i] && (strcmp(argv[i], "--profile") == 0 ||
+	                       startswith(argv[i], "--profile="))) {
+	    FILE *out = stderr;
+	    if (argv[i][strlen("--profile")] == '=') {
+		const char *path = argv[i] + strlen("--profile=");
+		out = fopen(path, "w");
+		if (out == NULL) {
+		    fprintf(stderr, "Could not open \"%s\" for writing: %s\n",
+		            path, strerror(errno));
+		    if (GvExitOnUsage) graphviz_exit(1);
+		    return(2);
+		}
+	    }
+	    gv_profile_enable(gvc, true, out);
 	} else if (argv[i] && argv[i][0] == '-') {
 	    rest = &argv[i][2];
 	    switch (c = argv[i][1]) {
@@ -16,11 +16,34 @@
 #include <assert.h>
 #include <cgraph/alloc.h>
 #include <cgraph/prisize_t.h>
+#include <common/profile.h>
 #include <common/render.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
 
+#define LENGTH(e)		(ND_rank(aghead(e)) - ND_rank(agtail(e)))
+#define SLACK(e)		(LENGTH(e) - ED_minlen(e))
+#define SEQ(a,b,c)		((a) <= (b) && (b) <= (c))
+#define TREE_EDGE(e)	(ED_tree_index(e) >= 0)
+
+#define SEARCHSIZE 30
+
+/// working state of a single network simplex run
+typedef struct {
+  graph_t *G;
+  size_t N_nodes, N_edges;
+  int Maxrank;
+  size_t S_i; ///< search index for enter_edge
+  int Search_size;
+  nlist_t Tree_node;
+  elist Tree_edge;
+  /// state for the enter_edge search
+  edge_t *Enter;
+  int Low, Lim, Slack;
+  int Iterations; ///< pivots of the last run, for profiling
+} network_simplex_ctx_t;
+
 static void dfs_cutval(node_t * v, edge_t * par);
 static int dfs_range_init(node_t * v, edge_t * par, int low);
 static int dfs_range(node_t * v, edge_t * par, int low);
@@ -29,21 +52,7 @@ static int x_val(edge_t * e, node_t * v, int dir);
 static void check_cycles(graph_t * g);
 #endif
 
-#define LENGTH(e)		(ND_rank(aghead(e)) - ND_rank(agtail(e)))
-#define SLACK(e)		(LENGTH(e) - ED_minlen(e))
-#define SEQ(a,b,c)		((a) <= (b) && (b) <= (c))
-#define TREE_EDGE(e)	(ED_tree_index(e) >= 0)
-
-static graph_t *G;
-static size_t N_nodes, N_edges;
-static int Maxrank;
-static size_t S_i;			/* search index for enter_edge */
-static int Search_size;
-#define SEARCHSIZE 30
-static nlist_t Tree_node;
-static elist Tree_edge;
-
-static int add_tree_edge(edge_t * e)
+static int add_tree_edge(network_simplex_ctx_t *ctx, edge_t * e)
 {
     node_t *n;
     //fprintf(stderr,"add tree edge %p %s ", (void*)e, agnameof(agtail(e))) ; fprintf(stderr,"%s\n", agnameof(aghead(e))) ;
@@ -51,13 +60,13 @@ static int add_tree_edge(edge_t * e)
 	agerr(AGERR, "add_tree_edge: missing tree edge\n");
 	return -1;
     }
-    assert(Tree_edge.size <= INT_MAX);
-    ED_tree_index(e) = (int)Tree_edge.size;
-    Tree_edge.list[Tree_edge.size++] = e;
+    assert(ctx->Tree_edge.size <= INT_MAX);
+    ED_tree_index(e) = (int)ctx->Tree_edge.size;
+    ctx->Tree_edge.list[ctx->Tree_edge.size++] = e;
     if (!ND_mark(agtail(e)))
-	Tree_node.list[Tree_node.size++] = agtail(e);
+	ctx->Tree_node.list[ctx->Tree_node.size++] = agtail(e);
     if (!ND_mark(aghead(e)))
-	Tree_node.list[Tree_node.size++] = aghead(e);
+	ctx->Tree_node.list[ctx->Tree_node.size++] = aghead(e);
     n = agtail(e);
     ND_mark(n) = TRUE;
     ND_tree_out(n).list[ND_tree_out(n).size++] = e;
@@ -106,12 +115,12 @@ static void invalidate_path(node_t *lca, node_t *to_node) {
     }
 }
 
-static void exchange_tree_edges(edge_t * e, edge_t * f)
+static void exchange_tree_edges(network_simplex_ctx_t *ctx, edge_t * e, edge_t * f)
 {
     node_t *n;
 
     ED_tree_index(f) = ED_tree_index(e);
-    Tree_edge.list[ED_tree_index(e)] = f;
+    ctx->Tree_edge.list[ED_tree_index(e)] = f;
     ED_tree_index(e) = -1;
 
     n = agtail(e);
@@ -139,17 +148,17 @@ static void exchange_tree_edges(edge_t * e, edge_t * f)
 }
 
 static
-void init_rank(void)
+void init_rank(network_simplex_ctx_t *ctx)
 {
     int i;
     nodequeue *Q;
     node_t *v;
     edge_t *e;
 
-    Q = new_queue(N_nodes);
+    Q = new_queue(ctx->N_nodes);
     size_t ctr = 0;
 
-    for (v = GD_nlist(G); v; v = ND_next(v)) {
+    for (v = GD_nlist(ctx->G); v; v = ND_next(v)) {
 	if (ND_priority(v) == 0)
 	    enqueue(Q, v);
     }
@@ -164,99 +173,96 @@ void init_rank(void)
 		enqueue(Q, aghead(e));
 	}
     }
-    if (ctr != N_nodes) {
+    if (ctr != ctx->N_nodes) {
 	agerr(AGERR, "trouble in init_rank\n");
-	for (v = GD_nlist(G); v; v = ND_next(v))
+	for (v = GD_nlist(ctx->G); v; v = ND_next(v))
 	    if (ND_priority(v))
 		agerr(AGPREV, "\t%s %d\n", agnameof(v), ND_priority(v));
     }
     free_queue(Q);
 }
 
-static edge_t *leave_edge(void)
+static edge_t *leave_edge(network_simplex_ctx_t *ctx)
 {
     edge_t *f, *rv = NULL;
     int cnt = 0;
 
-    size_t j = S_i;
-    while (S_i < Tree_edge.size) {
-	if (ED_cutvalue(f = Tree_edge.list[S_i]) < 0) {
+    size_t j = ctx->S_i;
+    while (ctx->S_i < ctx->Tree_edge.size) {
+	if (ED_cutvalue(f = ctx->Tree_edge.list[ctx->S_i]) < 0) {
 	    if (rv) {
 		if (ED_cutvalue(rv) > ED_cutvalue(f))
 		    rv = f;
 	    } else
-		rv = Tree_edge.list[S_i];
-	    if (++cnt >= Search_size)
+		rv = ctx->Tree_edge.list[ctx->S_i];
+	    if (++cnt >= ctx->Search_size)
 		return rv;
 	}
-	S_i++;
+	ctx->S_i++;
     }
     if (j > 0) {
-	S_i = 0;
-	while (S_i < j) {
-	    if (ED_cutvalue(f = Tree_edge.list[S_i]) < 0) {
+	ctx->S_i = 0;
+	while (ctx->S_i < j) {
+	    if (ED_cutvalue(f = ctx->Tree_edge.list[ctx->S_i]) < 0) {
 		if (rv) {
 		    if (ED_cutvalue(rv) > ED_cutvalue(f))
 			rv = f;
 		} else
-		    rv = Tree_edge.list[S_i];
-		if (++cnt >= Search_size)
+		    rv = ctx->Tree_edge.list[ctx->S_i];
+		if (++cnt >= ctx->Search_size)
 		    return rv;
 	    }
-	    S_i++;
+	    ctx->S_i++;
 	}
     }
     return rv;
 }
 
-static edge_t *Enter;
-static int Low, Lim, Slack;
-
-static void dfs_enter_outedge(node_t * v)
+static void dfs_enter_outedge(network_simplex_ctx_t *ctx, node_t * v)
 {
     int i, slack;
     edge_t *e;
 
     for (i = 0; (e = ND_out(v).list[i]); i++) {
 	if (!TREE_EDGE(e)) {
-	    if (!SEQ(Low, ND_lim(aghead(e)), Lim)) {
+	    if (!SEQ(ctx->Low, ND_lim(aghead(e)), ctx->Lim)) {
 		slack = SLACK(e);
-		if (slack < Slack || Enter == NULL) {
-		    Enter = e;
-		    Slack = slack;
+		if (slack < ctx->Slack || ctx->Enter == NULL) {
+		    ctx->Enter = e;
+		    ctx->Slack = slack;
 		}
 	    }
 	} else if (ND_lim(aghead(e)) < ND_lim(v))
-	    dfs_enter_outedge(aghead(e));
+	    dfs_enter_outedge(ctx, aghead(e));
     }
-    for (i = 0; (e = ND_tree_in(v).list[i]) && (Slack > 0); i++)
+    for (i = 0; (e = ND_tree_in(v).list[i]) && (ctx->Slack > 0); i++)
 	if (ND_lim(agtail(e)) < ND_lim(v))
-	    dfs_enter_outedge(agtail(e));
+	    dfs_enter_outedge(ctx, agtail(e));
 }
 
-static void dfs_enter_inedge(node_t * v)
+static void dfs_enter_inedge(network_simplex_ctx_t *ctx, node_t * v)
 {
     int i, slack;
     edge_t *e;
 
     for (i = 0; (e = ND_in(v).list[i]); i++) {
 	if (!TREE_EDGE(e)) {
-	    if (!SEQ(Low, ND_lim(agtail(e)), Lim)) {
+	    if (!SEQ(ctx->Low, ND_lim(agtail(e)), ctx->Lim)) {
 		slack = SLACK(e);
-		if (slack < Slack || Enter == NULL) {
-		    Enter = e;
-		    Slack = slack;
+		if (slack < ctx->Slack || ctx->Enter == NULL) {
+		    ctx->Enter = e;
+		    ctx->Slack = slack;
 		}
 	    }
 	} else if (ND_lim(agtail(e)) < ND_lim(v))
-	    dfs_enter_inedge(agtail(e));
+	    dfs_enter_inedge(ctx, agtail(e));
     }
-    for (i = 0; (e = ND_tree_out(v).list[i]) && Slack > 0; i++)
+    for (i = 0; (e = ND_tree_out(v).list[i]) && ctx->Slack > 0; i++)
 	if (ND_lim(aghead(e)) < ND_lim(v))
-	    dfs_enter_inedge(aghead(e));
+	    dfs_enter_inedge(ctx, aghead(e));
 }
 
-static edge_t *enter_edge(edge_t * e)
+static edge_t *enter_edge(network_simplex_ctx_t *ctx, edge_t * e)
 {
     node_t *v;
     int outsearch;
@@ -269,21 +275,21 @@ static edge_t *enter_edge(edge_t * e)
 	v = aghead(e);
 	outsearch = TRUE;
     }
-    Enter = NULL;
-    Slack = INT_MAX;
-    Low = ND_low(v);
-    Lim = ND_lim(v);
+    ctx->Enter = NULL;
+    ctx->Slack = INT_MAX;
+    ctx->Low = ND_low(v);
+    ctx->Lim = ND_lim(v);
     if (outsearch)
-	dfs_enter_outedge(v);
+	dfs_enter_outedge(ctx, v);
     else
-	dfs_enter_inedge(v);
-    return Enter;
+	dfs_enter_inedge(ctx, v);
+    return ctx->Enter;
 }
 
-static void init_cutvalues(void)
+static void init_cutvalues(network_simplex_ctx_t *ctx)
 {
-    dfs_range_init(GD_nlist(G), NULL, 1);
-    dfs_cutval(GD_nlist(G), NULL);
+    dfs_range_init(GD_nlist(ctx->G), NULL, 1);
+    dfs_cutval(GD_nlist(ctx->G), NULL);
 }
 
 /* functions for initial tight tree construction */
@@ -299,7 +305,7 @@ typedef struct subtree_s {
 } subtree_t;
 
 /* find initial tight subtrees */
-static int tight_subtree_search(Agnode_t *v, subtree_t *st)
+static int tight_subtree_search(network_simplex_ctx_t *ctx, Agnode_t *v, subtree_t *st)
 {
     Agedge_t *e;
     int     i;
@@ -310,30 +316,30 @@ static int tight_subtree_search(Agnode_t *v, subtree_t *st)
     for (i = 0; (e = ND_in(v).list[i]); i++) {
         if (TREE_EDGE(e)) continue;
         if (ND_subtree(agtail(e)) == 0 && SLACK(e) == 0) {
-               if (add_tree_edge(e) != 0) {
+               if (add_tree_edge(ctx, e) != 0) {
                    return -1;
                }
-               rv += tight_subtree_search(agtail(e),st);
+               rv += tight_subtree_search(ctx, agtail(e),st);
         }
     }
     for (i = 0; (e = ND_out(v).list[i]); i++) {
         if (TREE_EDGE(e)) continue;
         if (ND_subtree(aghead(e)) == 0 && SLACK(e) == 0) {
-               if (add_tree_edge(e) != 0) {
+               if (add_tree_edge(ctx, e) != 0) {
                    return -1;
                }
-               rv += tight_subtree_search(aghead(e),st);
+               rv += tight_subtree_search(ctx, aghead(e),st);
         }
     }
     return rv;
 }
 
-static subtree_t *find_tight_subtree(Agnode_t *v)
+static subtree_t *find_tight_subtree(network_simplex_ctx_t *ctx, Agnode_t *v)
 {
     subtree_t       *rv;
     rv = gv_alloc(sizeof(subtree_t));
     rv->rep = v;
-    rv->size = tight_subtree_search(v,rv);
+    rv->size = tight_subtree_search(ctx, v,rv);
     if (rv->size < 0) {
         free(rv);
         return NULL;
@@ -492,7 +498,7 @@ void tree_adjust(Agnode_t *v, Agnode_t *from, int delta)
 }
 
 static
-subtree_t *merge_trees(Agedge_t *e)   /* entering tree edge */
+subtree_t *merge_trees(network_simplex_ctx_t *ctx, Agedge_t *e)   /* entering tree edge */
 {
   int       delta;
   subtree_t *t0, *t1, *rv;
@@ -502,7 +508,7 @@ subtree_t *merge_trees(Agedge_t *e)   /* entering tree edge */
   t0 = STsetFind(agtail(e));
   t1 = STsetFind(aghead(e));
 
-  //fprintf(stderr,"merge trees of %d %d of %d, delta %d\n",t0->size,t1->size,N_nodes,delta);
+  //fprintf(stderr,"merge trees of %d %d of %d, delta %d\n",t0->size,t1->size,ctx->N_nodes,delta);
 
   if (t0->heap_index == -1) {   // move t0
     delta = SLACK(e);
@@ -514,7 +520,7 @@ subtree_t *merge_trees(Agedge_t *e)   /* entering tree edge */
     if (delta != 0)
       tree_adjust(t1->rep,NULL,delta);
   }
-  if (add_tree_edge(e) != 0) {
+  if (add_tree_edge(ctx, e) != 0) {
     return NULL;
   }
   rv = STsetUnion(t0,t1);
@@ -528,7 +534,7 @@ subtree_t *merge_trees(Agedge_t *e)   /* entering tree edge */
  * Return 1 if input graph is not connected; 0 on success.
  */
 static
-int feasible_tree(void)
+int feasible_tree(network_simplex_ctx_t *ctx)
 {
   Agnode_t *n;
   Agedge_t *ee;
@@ -538,15 +544,15 @@ int feasible_tree(void)
   int error = 0;
 
   /* initialization */
-  for (n = GD_nlist(G); n; n = ND_next(n)) {
+  for (n = GD_nlist(ctx->G); n; n = ND_next(n)) {
       ND_subtree_set(n,0);
   }
 
-  tree = N_NEW(N_nodes,subtree_t*);
+  tree = N_NEW(ctx->N_nodes,subtree_t*);
   /* given init_rank, find all tight subtrees */
-  for (n = GD_nlist(G); n; n = ND_next(n)) {
+  for (n = GD_nlist(ctx->G); n; n = ND_next(n)) {
         if (ND_subtree(n) == 0) {
-                tree[subtree_count] = find_tight_subtree(n);
+                tree[subtree_count] = find_tight_subtree(ctx, n);
                 if (tree[subtree_count] == NULL) {
                     error = 2;
                     goto end;
@@ -563,7 +569,7 @@ int feasible_tree(void)
       error = 1;
       break;
     }
-    tree1 = merge_trees(ee);
+    tree1 = merge_trees(ctx, ee);
     if (tree1 == NULL) {
       error = 2;
       break;
@@ -576,8 +582,8 @@ end:
   for (i = 0; i < subtree_count; i++) free(tree[i]);
   free(tree);
   if (error) return error;
-  assert(Tree_edge.size == N_nodes - 1);
-  init_cutvalues();
+  assert(ctx->Tree_edge.size == ctx->N_nodes - 1);
+  init_cutvalues(ctx);
   return 0;
 }
 
@@ -623,7 +629,7 @@ static void rerank(Agnode_t * v, int delta)
  * is entering.  compute new cut values, ranks, and exchange e and f.
  */
 static int
-update(edge_t * e, edge_t * f)
+update(network_simplex_ctx_t *ctx, edge_t * e, edge_t * f)
 {
     int cutvalue, delta;
     Agnode_t *lca;
@@ -661,26 +667,26 @@ update(edge_t * e, edge_t * f)
 
     ED_cutvalue(f) = -cutvalue;
     ED_cutvalue(e) = 0;
-    exchange_tree_edges(e, f);
+    exchange_tree_edges(ctx, e, f);
     dfs_range(lca, ND_par(lca), lca_low);
     return 0;
 }
 
-static void scan_and_normalize(void)
+static void scan_and_normalize(network_simplex_ctx_t *ctx)
 {
     node_t *n;
 
     int Minrank = INT_MAX;
-    Maxrank = -INT_MAX;
-    for (n = GD_nlist(G); n; n = ND_next(n)) {
+    ctx->Maxrank = -INT_MAX;
+    for (n = GD_nlist(ctx->G); n; n = ND_next(n)) {
 	if (ND_node_type(n) == NORMAL) {
 	    Minrank = MIN(Minrank, ND_rank(n));
-	    Maxrank = MAX(Maxrank, ND_rank(n));
+	    ctx->Maxrank = MAX(ctx->Maxrank, ND_rank(n));
 	}
     }
-    for (n = GD_nlist(G); n; n = ND_next(n))
+    for (n = GD_nlist(ctx->G); n; n = ND_next(n))
 	ND_rank(n) -= Minrank;
-    Maxrank -= Minrank;
+    ctx->Maxrank -= Minrank;
 }
 
 static void
@@ -694,15 +700,15 @@ freeTreeList (graph_t* g)
     }
 }
 
-static void LR_balance(void)
+static void LR_balance(network_simplex_ctx_t *ctx)
 {
     int delta;
     edge_t *e, *f;
 
-    for (size_t i = 0; i < Tree_edge.size; i++) {
-	e = Tree_edge.list[i];
+    for (size_t i = 0; i < ctx->Tree_edge.size; i++) {
+	e = ctx->Tree_edge.list[i];
 	if (ED_cutvalue(e) == 0) {
-	    f = enter_edge(e);
+	    f = enter_edge(ctx, e);
 	    if (f == NULL)
 		continue;
 	    delta = SLACK(f);
@@ -714,7 +720,7 @@ static void LR_balance(void)
 		rerank(aghead(e), -delta / 2);
 	}
     }
-    freeTreeList (G);
+    freeTreeList (ctx->G);
 }
 
 static int decreasingrankcmpf(node_t **n0, node_t **n1) {
@@ -737,7 +743,7 @@ static int increasingrankcmpf(node_t **n0, node_t **n1) {
   return 0;
 }
 
-static void TB_balance(void)
+static void TB_balance(network_simplex_ctx_t *ctx)
 {
     node_t *n;
     edge_t *e;
@@ -746,45 +752,45 @@ static void TB_balance(void)
     int adj = 0;
     char *s;
 
-    scan_and_normalize();
+    scan_and_normalize(ctx);
 
     /* find nodes that are not tight and move to less populated ranks */
-    nrank = N_NEW(Maxrank + 1, int);
-    for (int i = 0; i <= Maxrank; i++)
+    nrank = N_NEW(ctx->Maxrank + 1, int);
+    for (int i = 0; i <= ctx->Maxrank; i++)
 	nrank[i] = 0;
-    if ( (s = agget(G,"TBbalance")) ) {
+    if ( (s = agget(ctx->G,"TBbalance")) ) {
          if (streq(s,"min")) adj = 1;
          else if (streq(s,"max")) adj = 2;
-         if (adj) for (n = GD_nlist(G); n; n = ND_next(n))
+         if (adj) for (n = GD_nlist(ctx->G); n; n = ND_next(n))
               if (ND_node_type(n) == NORMAL) {
                 if (ND_in(n).size == 0 && adj == 1) {
                    ND_rank(n) = 0;
                 }
                 if (ND_out(n).size == 0 && adj == 2) {
-                   ND_rank(n) = Maxrank;
+                   ND_rank(n) = ctx->Maxrank;
                 }
               }
     }
     size_t ii;
-    for (ii = 0, n = GD_nlist(G); n; ii++, n = ND_next(n)) {
-      Tree_node.list[ii] = n;
+    for (ii = 0, n = GD_nlist(ctx->G); n; ii++, n = ND_next(n)) {
+      ctx->Tree_node.list[ii] = n;
     }
-    Tree_node.size = ii;
-    qsort(Tree_node.list, Tree_node.size, sizeof(Tree_node.list[0]),
+    ctx->Tree_node.size = ii;
+    qsort(ctx->Tree_node.list, ctx->Tree_node.size, sizeof(ctx->Tree_node.list[0]),
         adj > 1? (int(*)(const void*,const void*))decreasingrankcmpf
                : (int(*)(const void*,const void*))increasingrankcmpf);
-    for (size_t i = 0; i < Tree_node.size; i++) {
-        n = Tree_node.list[i];
+    for (size_t i = 0; i < ctx->Tree_node.size; i++) {
+        n = ctx->Tree_node.list[i];
         if (ND_node_type(n) == NORMAL)
           nrank[ND_rank(n)]++;
     }
-    for (ii = 0; ii < Tree_node.size; ii++) {
-      n = Tree_node.list[ii];
+    for (ii = 0; ii < ctx->Tree_node.size; ii++) {
+      n = ctx->Tree_node.list[ii];
       if (ND_node_type(n) != NORMAL)
         continue;
       inweight = outweight = 0;
       low = 0;
-      high = Maxrank;
+      high = ctx->Maxrank;
       for (size_t i = 0; (e = ND_in(n).list[i]); i++) {
         inweight += ED_weight(e);
         low = MAX(low, ND_rank(agtail(e)) + ED_minlen(e));
@@ -817,23 +823,23 @@ static void TB_balance(void)
     free(nrank);
 }
 
-static bool init_graph(graph_t *g) {
+static bool init_graph(network_simplex_ctx_t *ctx, graph_t *g) {
     node_t *n;
     edge_t *e;
 
-    G = g;
-    N_nodes = N_edges = S_i = 0;
+    ctx->G = g;
+    ctx->N_nodes = ctx->N_edges = ctx->S_i = 0;
     for (n = GD_nlist(g); n; n = ND_next(n)) {
 	ND_mark(n) = FALSE;
-	N_nodes++;
+	ctx->N_nodes++;
 	for (size_t i = 0; (e = ND_out(n).list[i]); i++)
-	    N_edges++;
+	    ctx->N_edges++;
     }
 
-    Tree_node.list = ALLOC(N_nodes, Tree_node.list, node_t *);
-    Tree_node.size = 0;
-    Tree_edge.list = ALLOC(N_nodes, Tree_edge.list, edge_t *);
-    Tree_edge.size = 0;
+    ctx->Tree_node.list = gv_calloc(ctx->N_nodes, sizeof(node_t *));
+    ctx->Tree_node.size = 0;
+    ctx->Tree_edge.list = gv_calloc(ctx->N_nodes, sizeof(edge_t *));
+    ctx->Tree_edge.size = 0;
 
     bool feasible = true;
     for (n = GD_nlist(g); n; n = ND_next(n)) {
@@ -888,7 +894,8 @@ graphSize (graph_t * g, int* nn, int* ne)
  * Returns 0 if successful; returns 1 if the graph was not connected;
  * returns 2 if something seriously wrong;
  */
-int rank2(graph_t * g, int balance, int maxiter, int search_size)
+static int rank2_(network_simplex_ctx_t *ctx, graph_t *g, int balance,
+                  int maxiter, int search_size)
 {
     int iter = 0;
     char *ns = "network simplex: ";
@@ -904,17 +911,17 @@ int rank2(graph_t * g, int balance, int maxiter, int search_size)
 	    nn, ne, maxiter, balance);
 	start_timer();
     }
-    bool feasible = init_graph(g);
+    bool feasible = init_graph(ctx, g);
     if (!feasible)
-	init_rank();
+	init_rank(ctx);
 
     if (search_size >= 0)
-	Search_size = search_size;
+	ctx->Search_size = search_size;
     else
-	Search_size = SEARCHSIZE;
+	ctx->Search_size = SEARCHSIZE;
 
     {
-	int err = feasible_tree();
+	int err = feasible_tree(ctx);
 	if (err != 0) {
 	    freeTreeList (g);
 	    return err;
@@ -925,10 +932,10 @@ int rank2(graph_t * g, int balance, int maxiter, int search_size)
 	return 0;
     }
 
-    while ((e = leave_edge())) {
+    while ((e = leave_edge(ctx))) {
 	int err;
-	f = enter_edge(e);
-	err = update(e, f);
+	f = enter_edge(ctx, e);
+	err = update(ctx, e, f);
 	if (err != 0) {
 	    freeTreeList (g);
 	    return err;
@@ -944,27 +951,40 @@ int rank2(graph_t * g, int balance, int maxiter, int search_size)
 	if (iter >= maxiter)
 	    break;
     }
+    ctx->Iterations = iter;
     switch (balance) {
     case 1:
-	TB_balance();
+	TB_balance(ctx);
 	break;
     case 2:
-	LR_balance();
+	LR_balance(ctx);
 	break;
     default:
-	scan_and_normalize();
-	freeTreeList (G);
+	scan_and_normalize(ctx);
+	freeTreeList (ctx->G);
 	break;
     }
     if (Verbose) {
 	if (iter >= 100)
 	    fputc('\n', stderr);
 	fprintf(stderr, "%s%" PRISIZE_T " nodes %" PRISIZE_T " edges %d iter %.2f sec\n",
-		ns, N_nodes, N_edges, iter, elapsed_sec());
+		ns, ctx->N_nodes, ctx->N_edges, iter, elapsed_sec());
     }
     return 0;
 }
 
+int rank2(graph_t * g, int balance, int maxiter, int search_size)
+{
+    network_simplex_ctx_t ctx = {0};
+    gv_span_begin("rank2");
+    const int rc = rank2_(&ctx, g, balance, maxiter, search_size);
+    gv_span_end();
+    gv_count("ns_iterations", ctx.Iterations);
+    free(ctx.Tree_node.list);
+    free(ctx.Tree_edge.list);
+    return rc;
+}
+
 int rank(graph_t * g, int balance, int maxiter)
 {
     char *s;
@@ -1113,7 +1133,7 @@ static int dfs_range(node_t * v, edge_t * par, int low)
 }
 
 #ifdef DEBUG
-void tchk(void)
+void tchk(network_simplex_ctx_t *ctx)
 {
     int i, n_cnt, e_cnt;
     node_t *n;
@@ -1121,7 +1141,7 @@ void tchk(void)
 
     n_cnt = 0;
     e_cnt = 0;
-    for (n = agfstnode(G); n; n = agnxtnode(G, n)) {
+    for (n = agfstnode(ctx->G); n; n = agnxtnode(ctx->G, n)) {
 	n_cnt++;
 	for (i = 0; (e = ND_tree_out(n).list[i]); i++) {
 	    e_cnt++;
@@ -1129,7 +1149,7 @@ void tchk(void)
 		fprintf(stderr, "not a tight tree %p", e);
 	}
     }
-    if (n_cnt != Tree_node.size || e_cnt != Tree_edge.size)
+    if (n_cnt != ctx->Tree_node.size || e_cnt != ctx->Tree_edge.size)
 	fprintf(stderr, "something missing\n");
 }
 
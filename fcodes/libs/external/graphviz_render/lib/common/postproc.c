@@ -15,9 +15,12 @@
 #include <label/xlabels.h>
 #include <stdbool.h>
 
-static int Rankdir;
-static bool Flip;
-static pointf Offset;
+/// per-graph state of @ref gv_postprocess
+typedef struct {
+  int rankdir;
+  bool flip;
+  pointf offset;
+} postproc_t;
 
 static void place_flip_graph_label(graph_t * g);
 
@@ -79,15 +82,15 @@ static void place_flip_graph_label(graph_t * g);
     closepath stroke\n\
 } def\n"
 
-static pointf map_point(pointf p)
+static pointf map_point(const postproc_t *pp, pointf p)
 {
-    p = ccwrotatepf(p, Rankdir * 90);
-    p.x -= Offset.x;
-    p.y -= Offset.y;
+    p = ccwrotatepf(p, pp->rankdir * 90);
+    p.x -= pp->offset.x;
+    p.y -= pp->offset.y;
     return p;
 }
 
-static void map_edge(edge_t * e)
+static void map_edge(const postproc_t *pp, edge_t * e)
 {
     int j, k;
     bezier bz;
@@ -101,67 +104,67 @@ static void map_edge(edge_t * e)
     for (j = 0; j < ED_spl(e)->size; j++) {
 	bz = ED_spl(e)->list[j];
 	for (k = 0; k < bz.size; k++)
-	    bz.list[k] = map_point(bz.list[k]);
+	    bz.list[k] = map_point(pp, bz.list[k]);
 	if (bz.sflag)
-	    ED_spl(e)->list[j].sp = map_point(ED_spl(e)->list[j].sp);
+	    ED_spl(e)->list[j].sp = map_point(pp, ED_spl(e)->list[j].sp);
 	if (bz.eflag)
-	    ED_spl(e)->list[j].ep = map_point(ED_spl(e)->list[j].ep);
+	    ED_spl(e)->list[j].ep = map_point(pp, ED_spl(e)->list[j].ep);
     }
     if (ED_label(e))
-	ED_label(e)->pos = map_point(ED_label(e)->pos);
+	ED_label(e)->pos = map_point(pp, ED_label(e)->pos);
     if (ED_xlabel(e))
-	ED_xlabel(e)->pos = map_point(ED_xlabel(e)->pos);
+	ED_xlabel(e)->pos = map_point(pp, ED_xlabel(e)->pos);
     if (ED_head_label(e))
-	ED_head_label(e)->pos = map_point(ED_head_label(e)->pos);
+	ED_head_label(e)->pos = map_point(pp, ED_head_label(e)->pos);
     if (ED_tail_label(e))
-	ED_tail_label(e)->pos = map_point(ED_tail_label(e)->pos);
+	ED_tail_label(e)->pos = map_point(pp, ED_tail_label(e)->pos);
 }
 
-void translate_bb(graph_t * g, int rankdir)
+static void translate_bb(const postproc_t *pp, graph_t *g, int rankdir)
 {
     int c;
     boxf bb, new_bb;
 
     bb = GD_bb(g);
     if (rankdir == RANKDIR_LR || rankdir == RANKDIR_BT) {
-	new_bb.LL = map_point((pointf){bb.LL.x, bb.UR.y});
-	new_bb.UR = map_point((pointf){bb.UR.x, bb.LL.y});
+	new_bb.LL = map_point(pp, (pointf){bb.LL.x, bb.UR.y});
+	new_bb.UR = map_point(pp, (pointf){bb.UR.x, bb.LL.y});
     } else {
-	new_bb.LL = map_point((pointf){bb.LL.x, bb.LL.y});
-	new_bb.UR = map_point((pointf){bb.UR.x, bb.UR.y});
+	new_bb.LL = map_point(pp, (pointf){bb.LL.x, bb.LL.y});
+	new_bb.UR = map_point(pp, (pointf){bb.UR.x, bb.UR.y});
     }
     GD_bb(g) = new_bb;
     if (GD_label(g)) {
-	GD_label(g)->pos = map_point(GD_label(g)->pos);
+	GD_label(g)->pos = map_point(pp, GD_label(g)->pos);
     }
     for (c = 1; c <= GD_n_cluster(g); c++)
-	translate_bb(GD_clust(g)[c], rankdir);
+	translate_bb(pp, GD_clust(g)[c], rankdir);
 }
 
 /* translate_drawing:
  * Translate and/or rotate nodes, spline points, and bbox info if
- * necessary. Also, if Rankdir (!= RANKDIR_BT), reset ND_lw, ND_rw, 
+ * necessary. Also, if rankdir (!= RANKDIR_BT), reset ND_lw, ND_rw, 
  * and ND_ht to correct value.
  */
-static void translate_drawing(graph_t * g)
+static void translate_drawing(const postproc_t *pp, graph_t *g)
 {
     node_t *v;
     edge_t *e;
-    bool shift = Offset.x || Offset.y;
+    bool shift = pp->offset.x || pp->offset.y;
 
-    if (!shift && !Rankdir)
+    if (!shift && !pp->rankdir)
 	return;
     for (v = agfstnode(g); v; v = agnxtnode(g, v)) {
-	if (Rankdir)
+	if (pp->rankdir)
 	    gv_nodesize(v, false);
-	ND_coord(v) = map_point(ND_coord(v));
+	ND_coord(v) = map_point(pp, ND_coord(v));
 	if (ND_xlabel(v))
-	    ND_xlabel(v)->pos = map_point(ND_xlabel(v)->pos);
+	    ND_xlabel(v)->pos = map_point(pp, ND_xlabel(v)->pos);
 	if (State == GVSPLINES)
 	    for (e = agfstout(g, v); e; e = agnxtout(g, e))
-		map_edge(e);
+		map_edge(pp, e);
     }
-    translate_bb(g, GD_rankdir(g));
+    translate_bb(pp, g, GD_rankdir(g));
 }
 
 /* place_root_label:
@@ -293,7 +296,7 @@ adjustBB (object_t* objp, boxf bb)
  * If initObj is set, initialize the object.
  */
 static void
-addXLabel (textlabel_t* lp, object_t* objp, xlabel_t* xlp, int initObj, pointf pos)
+addXLabel (bool flip, textlabel_t* lp, object_t* objp, xlabel_t* xlp, int initObj, pointf pos)
 {
     if (initObj) {
 	objp->sz.x = 0;
@@ -301,7 +304,7 @@ addXLabel (textlabel_t* lp, object_t* objp, xlabel_t* xlp, int initObj, pointf p
 	objp->pos = pos;
     }
 
-    if (Flip) {
+    if (flip) {
 	xlp->sz.x = lp->dimen.y;
 	xlp->sz.y = lp->dimen.x;
     }
@@ -320,9 +323,9 @@ addXLabel (textlabel_t* lp, object_t* objp, xlabel_t* xlp, int initObj, pointf p
  * Then adjust given bounding box bb to include label and return new bb.
  */
 static boxf
-addLabelObj (textlabel_t* lp, object_t* objp, boxf bb)
+addLabelObj (bool flip, textlabel_t* lp, object_t* objp, boxf bb)
 {
-    if (Flip) {
+    if (flip) {
 	objp->sz.x = lp->dimen.y; 
 	objp->sz.y = lp->dimen.x;
     }
@@ -343,9 +346,9 @@ addLabelObj (textlabel_t* lp, object_t* objp, boxf bb)
  * Then adjust given bounding box bb to include label and return new bb.
  */
 static boxf
-addNodeObj (node_t* np, object_t* objp, boxf bb)
+addNodeObj (bool flip, node_t* np, object_t* objp, boxf bb)
 {
-    if (Flip) {
+    if (flip) {
 	objp->sz.x = INCH2PS(ND_height(np));
 	objp->sz.y = INCH2PS(ND_width(np));
     }
@@ -366,15 +369,15 @@ typedef struct {
 } cinfo_t;
 
 static cinfo_t
-addClusterObj (Agraph_t* g, cinfo_t info)
+addClusterObj (bool flip, Agraph_t* g, cinfo_t info)
 {
     int c;
 
     for (c = 1; c <= GD_n_cluster(g); c++)
-	info = addClusterObj (GD_clust(g)[c], info);
+	info = addClusterObj (flip, GD_clust(g)[c], info);
     if (g != agroot(g) && GD_label(g) && GD_label(g)->set) {
 	object_t* objp = info.objp;
-	info.bb = addLabelObj (GD_label(g), objp, info.bb);
+	info.bb = addLabelObj (flip, GD_label(g), objp, info.bb);
 	info.objp++;
     }
 
@@ -399,7 +402,7 @@ static size_t countClusterLabels(Agraph_t *g) {
   /* True if edges geometries were computed and this edge has a geometry */
 #define HAVE_EDGE(ep) ((et != EDGETYPE_NONE) && (ED_spl(ep) != NULL))
 
-static void addXLabels(Agraph_t * gp)
+static void addXLabels(bool flip, Agraph_t * gp)
 {
     Agnode_t *np;
     Agedge_t *ep;
@@ -476,15 +479,15 @@ static void addXLabels(Agraph_t * gp)
 
     for (np = agfstnode(gp); np; np = agnxtnode(gp, np)) {
 
-	bb = addNodeObj (np, objp, bb);
+	bb = addNodeObj (flip, np, objp, bb);
 	if ((lp = ND_xlabel(np))) {
 	    if (lp->set) {
 		objp++;
-		bb = addLabelObj (lp, objp, bb);
+		bb = addLabelObj (flip, lp, objp, bb);
 	    }
 	    else {
 		pointf ignored = { 0.0, 0.0 };
-		addXLabel (lp, objp, xlp, 0, ignored);
+		addXLabel (flip, lp, objp, xlp, 0, ignored);
 		xlp++;
 	    }
 	}
@@ -492,10 +495,10 @@ static void addXLabels(Agraph_t * gp)
 	for (ep = agfstout(gp, np); ep; ep = agnxtout(gp, ep)) {
 	    if ((lp = ED_label(ep))) {
 		if (lp->set) {
-		    bb = addLabelObj (lp, objp, bb);
+		    bb = addLabelObj (flip, lp, objp, bb);
 		}
 		else if (HAVE_EDGE(ep)) {
-		    addXLabel (lp, objp, xlp, 1, edgeMidpoint(gp, ep)); 
+		    addXLabel (flip, lp, objp, xlp, 1, edgeMidpoint(gp, ep)); 
 		    xlp++;
 		}
 		else {
@@ -507,10 +510,10 @@ static void addXLabels(Agraph_t * gp)
 	    }
 	    if ((lp = ED_tail_label(ep))) {
 		if (lp->set) {
-		    bb = addLabelObj (lp, objp, bb);
+		    bb = addLabelObj (flip, lp, objp, bb);
 		}
 		else if (HAVE_EDGE(ep)) {
-		    addXLabel (lp, objp, xlp, 1, edgeTailpoint(ep)); 
+		    addXLabel (flip, lp, objp, xlp, 1, edgeTailpoint(ep)); 
 		    xlp++;
 		}
 		else {
@@ -522,10 +525,10 @@ static void addXLabels(Agraph_t * gp)
 	    }
 	    if ((lp = ED_head_label(ep))) {
 		if (lp->set) {
-		    bb = addLabelObj (lp, objp, bb);
+		    bb = addLabelObj (flip, lp, objp, bb);
 		}
 		else if (HAVE_EDGE(ep)) {
-		    addXLabel (lp, objp, xlp, 1, edgeHeadpoint(ep)); 
+		    addXLabel (flip, lp, objp, xlp, 1, edgeHeadpoint(ep)); 
 		    xlp++;
 		}
 		else {
@@ -537,10 +540,10 @@ static void addXLabels(Agraph_t * gp)
 	    }
 	    if ((lp = ED_xlabel(ep))) {
 		if (lp->set) {
-		    bb = addLabelObj (lp, objp, bb);
+		    bb = addLabelObj (flip, lp, objp, bb);
 		}
 		else if (HAVE_EDGE(ep)) {
-		    addXLabel (lp, objp, xlp, 1, edgeMidpoint(gp, ep)); 
+		    addXLabel (flip, lp, objp, xlp, 1, edgeMidpoint(gp, ep)); 
 		    xlp++;
 		}
 		else {
@@ -556,7 +559,7 @@ static void addXLabels(Agraph_t * gp)
 	cinfo_t info;
 	info.bb = bb;
 	info.objp = objp;
-	info = addClusterObj (gp, info);
+	info = addClusterObj (flip, gp, info);
 	bb = info.bb;
     }
 
@@ -603,10 +606,9 @@ void gv_postprocess(Agraph_t * g, int allowTranslation)
     pointf dimen = { 0., 0. };
 
 
-    Rankdir = GD_rankdir(g);
-    Flip = GD_flip(g);
+    postproc_t pp = {.rankdir = GD_rankdir(g), .flip = GD_flip(g)};
     /* Handle cluster labels */
-    if (Flip)
+    if (pp.flip)
 	place_flip_graph_label(g);
     else
 	place_graph_label(g);
@@ -614,13 +616,13 @@ void gv_postprocess(Agraph_t * g, int allowTranslation)
     /* Everything has been placed except the root graph label, if any.
      * The graph positions have not yet been rotated back if necessary.
      */
-    addXLabels(g);
+    addXLabels(pp.flip, g);
 
     /* Add space for graph label if necessary */
     if (GD_label(g) && !GD_label(g)->set) {
 	dimen = GD_label(g)->dimen;
 	PAD(dimen);
-	if (Flip) {
+	if (pp.flip) {
 	    if (GD_label_pos(g) & LABEL_AT_TOP) {
 		GD_bb(g).UR.x += dimen.y;
 	    } else {
@@ -635,12 +637,12 @@ void gv_postprocess(Agraph_t * g, int allowTranslation)
 	    }
 	} else {
 	    if (GD_label_pos(g) & LABEL_AT_TOP) {
-		if (Rankdir == RANKDIR_TB)
+		if (pp.rankdir == RANKDIR_TB)
 		    GD_bb(g).UR.y += dimen.y;
 		else
 		    GD_bb(g).LL.y -= dimen.y;
 	    } else {
-		if (Rankdir == RANKDIR_TB)
+		if (pp.rankdir == RANKDIR_TB)
 		    GD_bb(g).LL.y -= dimen.y;
 		else
 		    GD_bb(g).UR.y += dimen.y;
@@ -655,34 +657,34 @@ void gv_postprocess(Agraph_t * g, int allowTranslation)
 	}
     }
     if (allowTranslation) {
-	switch (Rankdir) {
+	switch (pp.rankdir) {
 	case RANKDIR_TB:
-	    Offset = GD_bb(g).LL;
+	    pp.offset = GD_bb(g).LL;
 	    break;
 	case RANKDIR_LR:
-	    Offset = (pointf){-GD_bb(g).UR.y, GD_bb(g).LL.x};
+	    pp.offset = (pointf){-GD_bb(g).UR.y, GD_bb(g).LL.x};
 	    break;
 	case RANKDIR_BT:
-	    Offset = (pointf){GD_bb(g).LL.x, -GD_bb(g).UR.y};
+	    pp.offset = (pointf){GD_bb(g).LL.x, -GD_bb(g).UR.y};
 	    break;
 	case RANKDIR_RL:
-	    Offset = (pointf){GD_bb(g).LL.y, GD_bb(g).LL.x};
+	    pp.offset = (pointf){GD_bb(g).LL.y, GD_bb(g).LL.x};
 	    break;
 	default:
 	    UNREACHABLE();
 	}
-	translate_drawing(g);
+	translate_drawing(&pp, g);
     }
     if (GD_label(g) && !GD_label(g)->set)
 	place_root_label(g, dimen);
 
     if (!show_boxes_is_empty(&Show_boxes)) {
 	agxbuf buf = {0};
-	if (Flip)
-	    agxbprint(&buf, M2, Offset.x, Offset.y, Offset.x, Offset.y);
+	if (pp.flip)
+	    agxbprint(&buf, M2, pp.offset.x, pp.offset.y, pp.offset.x, pp.offset.y);
 	else
-	    agxbprint(&buf, M1, Offset.y, Offset.x, Offset.y, Offset.x,
-		    -Offset.x, -Offset.y);
+	    agxbprint(&buf, M1, pp.offset.y, pp.offset.x, pp.offset.y, pp.offset.x,
+		    -pp.offset.x, -pp.offset.y);
 	show_boxes_append(&Show_boxes, agxbdisown(&buf));
     }
 }
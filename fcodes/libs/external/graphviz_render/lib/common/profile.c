@@ -0,0 +1,331 @@
+/// \file
+/// \brief timing of layout and render phases and counters of their work
+
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#include "config.h"
+
+#include <assert.h>
+#include <cgraph/agxbuf.h>
+#include <cgraph/alloc.h>
+#include <common/profile.h>
+#include <common/render.h>
+#include <gvc/gvcint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#define TLS __declspec(thread)
+#elif defined(__GNUC__)
+#define TLS __thread
+#else
+// assume this environment does not support threads and fall back to (thread
+// unsafe) globals
+#define TLS /* nothing */
+#endif
+
+/// no span, as parent, child or sibling
+#define NO_SPAN SIZE_MAX
+
+/// a phase, merged over all of its runs under the same parent
+typedef struct {
+  const char *name;
+  size_t parent;
+  size_t first_child;
+  size_t next_sibling;
+  size_t calls;
+  double seconds;
+  double start; ///< clock at the beginning of the current run
+} span_t;
+
+typedef struct {
+  const char *name;
+  double value;
+} counter_t;
+
+/// the profile of one graph
+typedef struct {
+  Agraph_t *g;
+  char *graph;  ///< name of the graph
+  char *layout; ///< layout engine of the context, or NULL if none
+  FILE *out;    ///< where to write the profile, or NULL to keep it
+  span_t *spans; ///< a root without a name, then the phases
+  size_t n_spans;
+  size_t spans_capacity;
+  size_t current; ///< innermost running span, 0 if none
+  counter_t *counters;
+  size_t n_counters;
+  size_t counters_capacity;
+} record_t;
+
+/// profiling state of a context
+struct gvprofile_s {
+  bool enabled; ///< profile all graphs?
+  FILE *out;    ///< where profiles of all graphs go, or NULL to keep them
+  record_t *open; ///< profile of the graph being laid out or rendered
+  agxbuf kept;    ///< comma separated profiles for `gv_profile_json`
+};
+
+/// profile the calling thread is recording to
+static TLS record_t *current;
+
+static size_t add_span(record_t *r, const char *name, size_t parent) {
+  if (r->n_spans == r->spans_capacity) {
+    const size_t c = r->spans_capacity == 0 ? 16 : 2 * r->spans_capacity;
+    r->spans = gv_recalloc(r->spans, r->spans_capacity, c, sizeof(span_t));
+    r->spans_capacity = c;
+  }
+  const size_t i = r->n_spans++;
+  r->spans[i] = (span_t){.name = name,
+                         .parent = parent,
+                         .first_child = NO_SPAN,
+                         .next_sibling = NO_SPAN};
+  return i;
+}
+
+static record_t *record_new(GVC_t *gvc, Agraph_t *g, FILE *out) {
+  record_t *r = gv_alloc(sizeof(record_t));
+  r->g = g;
+  r->graph = gv_strdup(agnameof(g));
+  if (gvc->layout.type != NULL && gvc->layout.engine != NULL)
+    r->layout = gv_strdup(gvc->layout.type);
+  r->out = out;
+  (void)add_span(r, NULL, NO_SPAN);
+  return r;
+}
+
+static void record_free(record_t *r) {
+  if (r == NULL)
+    return;
+  free(r->graph);
+  free(r->layout);
+  free(r->spans);
+  free(r->counters);
+  free(r);
+}
+
+bool gv_profiling(void) { return current != NULL; }
+
+void gv_span_begin(const char *name) {
+  record_t *r = current;
+  if (r == NULL)
+    return;
+  assert(name != NULL);
+
+  // find the span of this name under the running one, or append it
+  size_t last = NO_SPAN;
+  size_t i = r->spans[r->current].first_child;
+  while (i != NO_SPAN && strcmp(r->spans[i].name, name) != 0) {
+    last = i;
+    i = r->spans[i].next_sibling;
+  }
+  if (i == NO_SPAN) {
+    i = add_span(r, name, r->current);
+    if (last == NO_SPAN) {
+      r->spans[r->current].first_child = i;
+    } else {
+      r->spans[last].next_sibling = i;
+    }
+  }
+
+  ++r->spans[i].calls;
+  r->current = i;
+  r->spans[i].start = gv_clock();
+}
+
+void gv_span_end(void) {
+  const double now = gv_clock();
+  record_t *r = current;
+  if (r == NULL || r->current == 0)
+    return;
+  span_t *s = &r->spans[r->current];
+  s->seconds += now - s->start;
+  r->current = s->parent;
+}
+
+void gv_count(const char *name, double value) {
+  record_t *r = current;
+  if (r == NULL)
+    return;
+  assert(name != NULL);
+
+  for (size_t i = 0; i < r->n_counters; ++i) {
+    if (strcmp(r->counters[i].name, name) == 0) {
+      r->counters[i].value += value;
+      return;
+    }
+  }
+  if (r->n_counters == r->counters_capacity) {
+    const size_t c = r->counters_capacity == 0 ? 16 : 2 * r->counters_capacity;
+    r->counters =
+        gv_recalloc(r->counters, r->counters_capacity, c, sizeof(counter_t));
+    r->counters_capacity = c;
+  }
+  r->counters[r->n_counters++] = (counter_t){.name = name, .value = value};
+}
+
+static void json_string(agxbuf *xb, const char *s) {
+  agxbputc(xb, '"');
+  for (; *s != '\0'; ++s) {
+    const unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\') {
+      agxbprint(xb, "\\%c", c);
+    } else if (c < 0x20) {
+      agxbprint(xb, "\\u%04x", c);
+    } else {
+      agxbputc(xb, (char)c);
+    }
+  }
+  agxbputc(xb, '"');
+}
+
+static void json_spans(agxbuf *xb, const record_t *r, size_t parent) {
+  agxbputc(xb, '[');
+  for (size_t i = r->spans[parent].first_child; i != NO_SPAN;
+       i = r->spans[i].next_sibling) {
+    const span_t *s = &r->spans[i];
+    if (i != r->spans[parent].first_child)
+      agxbputc(xb, ',');
+    agxbput(xb, "{\"name\":");
+    json_string(xb, s->name);
+    agxbprint(xb, ",\"calls\":%zu,\"seconds\":%.6f,\"children\":", s->calls,
+              s->seconds);
+    json_spans(xb, r, i);
+    agxbputc(xb, '}');
+  }
+  agxbputc(xb, ']');
+}
+
+static void json_record(agxbuf *xb, const record_t *r) {
+  agxbput(xb, "{\"graph\":");
+  json_string(xb, r->graph);
+  agxbput(xb, ",\"layout\":");
+  if (r->layout == NULL) {
+    agxbput(xb, "null");
+  } else {
+    json_string(xb, r->layout);
+  }
+  agxbput(xb, ",\"spans\":");
+  json_spans(xb, r, 0);
+  agxbput(xb, ",\"counters\":{");
+  for (size_t i = 0; i < r->n_counters; ++i) {
+    if (i > 0)
+      agxbputc(xb, ',');
+    json_string(xb, r->counters[i].name);
+    agxbprint(xb, ":%.15g", r->counters[i].value);
+  }
+  agxbput(xb, "}}");
+}
+
+static struct gvprofile_s *profile_of(GVC_t *gvc) {
+  if (gvc->profile == NULL)
+    gvc->profile = gv_alloc(sizeof(struct gvprofile_s));
+  return gvc->profile;
+}
+
+static void close_out(FILE *out) {
+  if (out != NULL && out != stdout && out != stderr)
+    fclose(out);
+}
+
+void gv_profile_enable(GVC_t *gvc, bool enable, FILE *out) {
+  struct gvprofile_s *p = profile_of(gvc);
+  gv_profile_finish(gvc);
+  if (p->out != out)
+    close_out(p->out);
+  p->enabled = enable;
+  p->out = enable ? out : NULL;
+}
+
+bool gv_profile_start(GVC_t *gvc, Agraph_t *g) {
+  // a layout nested in another, as done by some engines for components, is
+  // part of the outer profile
+  if (current != NULL)
+    return false;
+
+  struct gvprofile_s *p = gvc->profile;
+  if (p != NULL && p->open != NULL && p->open->g == g) {
+    current = p->open;
+    return true;
+  }
+
+  const bool enabled = p != NULL && p->enabled;
+  if (!enabled && !mapbool(agget(g, "profile")))
+    return false;
+
+  p = profile_of(gvc);
+  gv_profile_finish(gvc);
+  p->open = record_new(gvc, g, enabled ? p->out : stderr);
+  current = p->open;
+  return true;
+}
+
+void gv_profile_suspend(GVC_t *gvc) {
+  (void)gvc;
+  current = NULL;
+}
+
+void gv_profile_finish(GVC_t *gvc) {
+  struct gvprofile_s *p = gvc->profile;
+  current = NULL;
+  if (p == NULL || p->open == NULL)
+    return;
+
+  record_t *r = p->open;
+  p->open = NULL;
+
+  // close what an early return left running
+  const double now = gv_clock();
+  for (size_t i = r->current; i != 0; i = r->spans[i].parent)
+    r->spans[i].seconds += now - r->spans[i].start;
+
+  agxbuf xb = {0};
+  json_record(&xb, r);
+  if (r->out != NULL) {
+    fprintf(r->out, "%s\n", agxbuse(&xb));
+    fflush(r->out);
+  } else {
+    if (agxblen(&p->kept) > 0)
+      agxbputc(&p->kept, ',');
+    agxbput(&p->kept, agxbuse(&xb));
+  }
+  agxbfree(&xb);
+  record_free(r);
+}
+
+void gv_profile_release(GVC_t *gvc, Agraph_t *g) {
+  struct gvprofile_s *p = gvc->profile;
+  if (p != NULL && p->open != NULL && p->open->g == g)
+    gv_profile_finish(gvc);
+}
+
+char *gv_profile_json(GVC_t *gvc) {
+  struct gvprofile_s *p = profile_of(gvc);
+  gv_profile_finish(gvc);
+  agxbuf xb = {0};
+  agxbprint(&xb, "[%s]", agxbuse(&p->kept));
+  return agxbdisown(&xb);
+}
+
+void gv_profile_free(GVC_t *gvc) {
+  struct gvprofile_s *p = gvc->profile;
+  if (p == NULL)
+    return;
+  gv_profile_finish(gvc);
+  close_out(p->out);
+  agxbfree(&p->kept);
+  free(p);
+  gvc->profile = NULL;
+}
@@ -0,0 +1,93 @@
+/// \file
+/// \brief timing of layout and render phases and counters of their work
+///
+/// While a graph is laid out or rendered with profiling enabled, the phases
+/// bracketed by `gv_span_begin` and `gv_span_end` are timed and the values
+/// passed to `gv_count` are summed. Spans nest; repeated spans of the same
+/// name under the same parent are merged, so a profile stays small however
+/// often a phase runs. When profiling is off, all of these return at once.
+///
+/// The profile being recorded is kept per thread, so layouts running on
+/// different threads, with different contexts, do not mix.
+
+#pragma once
+
+#include <cgraph/cgraph.h>
+#include <gvc/gvcext.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef GVDLL
+#ifdef GVC_EXPORTS
+#define PROFILE_API __declspec(dllexport)
+#else
+#define PROFILE_API __declspec(dllimport)
+#endif
+#endif
+
+#ifndef PROFILE_API
+#define PROFILE_API /* nothing */
+#endif
+
+/// is a profile being recorded by this thread?
+PROFILE_API bool gv_profiling(void);
+
+/// start timing a phase
+///
+/// \param name Name of the phase, which must outlive the profile. String
+///   literals are expected.
+PROFILE_API void gv_span_begin(const char *name);
+
+/// stop timing the phase most recently begun
+PROFILE_API void gv_span_end(void);
+
+/// add to a counter, creating it at 0 if need be
+///
+/// \param name Name of the counter, which must outlive the profile
+/// \param value Amount to add
+PROFILE_API void gv_count(const char *name, double value);
+
+/// \defgroup profile_gvc profiling of a context, for use by gvc
+/// \{
+
+/// enable or disable profiling for all graphs of a context
+///
+/// \param out Where to write each finished profile as a line of JSON, or
+///   NULL to keep them for `gv_profile_json`
+void gv_profile_enable(GVC_t *gvc, bool enable, FILE *out);
+
+/// start or resume the profile of a graph for the calling thread
+///
+/// Profiling happens if it was enabled for `gvc` or if `g` has the attribute
+/// `profile=true`. A profile suspended after laying out `g` is resumed by the
+/// following render of `g`.
+///
+/// \return Whether the caller must call `gv_profile_suspend` or
+///   `gv_profile_finish` when done
+bool gv_profile_start(GVC_t *gvc, Agraph_t *g);
+
+/// detach the profile from the calling thread, leaving it open for a render
+void gv_profile_suspend(GVC_t *gvc);
+
+/// complete the open profile of a context and write or keep it
+void gv_profile_finish(GVC_t *gvc);
+
+/// finish the profile of `g`, if it is open
+void gv_profile_release(GVC_t *gvc, Agraph_t *g);
+
+/// \return JSON array of the profiles kept since the last call, to be freed
+///   by the caller
+char *gv_profile_json(GVC_t *gvc);
+
+/// release the profiling state of a context
+void gv_profile_free(GVC_t *gvc);
+
+/// \}
+
+#ifdef __cplusplus
+}
+#endif
@@ -136,9 +136,12 @@ extern "C" {
     RENDER_API int stripedBox (GVJ_t * job, pointf* AF, char* clrs, int rotate);
     RENDER_API stroke_t taper (bezier*, double (*radfunc_t)(double,double,double), double initwid);
     RENDER_API pointf textspan_size(GVC_t * gvc, textspan_t * span);
+    RENDER_API void textspan_layout(GVC_t *gvc, textspan_t *span);
     RENDER_API void textfont_dict_open(GVC_t *gvc);
     RENDER_API void textfont_dict_close(GVC_t *gvc);
-    RENDER_API void translate_bb(Agraph_t *, int);
+    RENDER_API void textspan_cache_enable(GVC_t *gvc, bool enable);
+    RENDER_API void textspan_cache_renderer(GVC_t *gvc, int render_flags);
+    RENDER_API void textspan_cache_stats(GVC_t *gvc, size_t *hits, size_t *misses);
     RENDER_API int wedgedEllipse (GVJ_t* job, pointf * pf, char* clrs);
     RENDER_API void update_bb_bz(boxf *bb, pointf *cp);
     RENDER_API boxf xdotBB (graph_t* g);
@@ -13,6 +13,7 @@
 #include <cgraph/agxbuf.h>
 #include <cgraph/alloc.h>
 #include <common/geomprocs.h>
+#include <common/profile.h>
 #include <common/render.h>
 #include <limits.h>
 #include <math.h>
@@ -335,6 +336,8 @@ static pointf *_routesplines(path * pp, int *npoints, int polyline)
     *npoints = 0;
     nedges++;
     nboxes += pp->nbox;
+    gv_count("spline_routes", 1);
+    gv_count("spline_boxes", pp->nbox);
 
     for (realedge = pp->data;
 	 realedge && ED_edge_type(realedge) != NORMAL;
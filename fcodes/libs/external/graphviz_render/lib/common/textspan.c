@@ -13,13 +13,21 @@
  * Contributors: Details at https://graphviz.org
  *************************************************************************/
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <cdt/cdt.h>
+#include <cgraph/alloc.h>
+#include <common/profile.h>
 #include <common/render.h>
 #include <common/textspan_lut.h>
 #include <cgraph/strcasecmp.h>
+#include <gvc/gvcint.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 /* estimate_textspan_size:
  * Estimate size of textspan, for given face and size, in points.
@@ -61,17 +69,150 @@ static int fontcmpf(const void *a, const void *b)
 
 static PostscriptAlias* translate_postscript_fontname(char* fontname)
 {
-    static PostscriptAlias key;
-    static PostscriptAlias *result;
-
-    if (key.name == NULL || strcasecmp(key.name, fontname)) {
-	free(key.name);
-        key.name = strdup(fontname);
-        result = bsearch(&key, postscript_alias,
-                         sizeof(postscript_alias) / sizeof(PostscriptAlias),
-                         sizeof(PostscriptAlias), fontcmpf);
+    /* looked up once per font, see textspan_size, so not worth remembering */
+    PostscriptAlias key = {.name = fontname};
+
+    return bsearch(&key, postscript_alias,
+                   sizeof(postscript_alias) / sizeof(PostscriptAlias),
+                   sizeof(PostscriptAlias), fontcmpf);
+}
+
+/// number of entries in the text span cache of a context, a power of 2
+#define TEXTSPAN_CACHE_SIZE 4096
+
+/// a measured text span
+typedef struct {
+    char *str; ///< text of the span, NULL if the entry is unused
+    char *fontname;
+    double fontsize;
+    unsigned flags;
+    pointf size;
+    double yoffset_layout, yoffset_centerline;
+} textspan_cache_entry_t;
+
+/// sizes of text spans measured in a context
+///
+/// Labels tend to repeat the same strings in the same fonts, within a graph
+/// and across the graphs rendered with one context, and measuring them with a
+/// text layout plugin is slow. The cache is direct mapped: a span can only be
+/// kept in the entry its hash selects, and replaces whatever was there.
+///
+/// Only sizes are cached, not the layout a text layout plugin makes along with
+/// them, so the cache only pays off when that layout is not drawn. Once the
+/// context selects a renderer that draws from span layouts, such as cairo or
+/// LASi, the cache is no longer consulted and spans are measured as before.
+///
+/// Entries are read and written under a spin lock, held only to compare and
+/// copy an entry, never while measuring, and the counters are updated
+/// atomically, so spans can be measured from several threads at once.
+typedef struct textspan_cache_s {
+    bool disabled;
+    bool layouts_drawn; ///< a renderer drawing from span layouts was selected
+    int lock;
+    size_t hits, misses;
+    textspan_cache_entry_t entries[TEXTSPAN_CACHE_SIZE];
+} textspan_cache_t;
+
+#ifdef _MSC_VER
+static void cache_lock(textspan_cache_t *cache) {
+    while (_InterlockedExchange((volatile long *)&cache->lock, 1))
+        ;
+}
+
+static void cache_unlock(textspan_cache_t *cache) {
+    _InterlockedExchange((volatile long *)&cache->lock, 0);
+}
+
+#ifdef _WIN64
+#define COUNTER_ADD(p, v) _InterlockedExchangeAdd64((volatile __int64 *)(p), (v))
+#else
+#define COUNTER_ADD(p, v) _InterlockedExchangeAdd((volatile long *)(p), (v))
+#endif
+#define COUNTER_LOAD(p) ((size_t)COUNTER_ADD((p), 0))
+#else
+static void cache_lock(textspan_cache_t *cache) {
+    while (__atomic_exchange_n(&cache->lock, 1, __ATOMIC_ACQUIRE))
+        ;
+}
+
+static void cache_unlock(textspan_cache_t *cache) {
+    __atomic_store_n(&cache->lock, 0, __ATOMIC_RELEASE);
+}
+
+#define COUNTER_ADD(p, v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define COUNTER_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#endif
+
+static void textspan_cache_clear(textspan_cache_t *cache) {
+    for (size_t i = 0; i < TEXTSPAN_CACHE_SIZE; i++) {
+        free(cache->entries[i].str);
+        free(cache->entries[i].fontname);
+        cache->entries[i].str = NULL;
+        cache->entries[i].fontname = NULL;
     }
-    return result;
+}
+
+/// FNV-1a hash of a byte range, continuing from `h`
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+/// the cache entry a span may be kept in, NULL if it cannot be cached
+///
+/// The caller must hold the lock of the cache.
+static textspan_cache_entry_t *textspan_cache_entry(textspan_cache_t *cache,
+                                                    const textspan_t *span) {
+    const textfont_t *font = span->font;
+    if (cache->disabled || cache->layouts_drawn || !span->str)
+        return NULL;
+
+    const unsigned flags = font->flags;
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = hash_bytes(h, span->str, strlen(span->str) + 1);
+    h = hash_bytes(h, font->name, strlen(font->name) + 1);
+    h = hash_bytes(h, &font->size, sizeof(font->size));
+    h = hash_bytes(h, &flags, sizeof(flags));
+    return &cache->entries[h & (TEXTSPAN_CACHE_SIZE - 1)];
+}
+
+static bool textspan_cache_match(const textspan_cache_entry_t *entry,
+                                 const textspan_t *span) {
+    const textfont_t *font = span->font;
+    return entry->str && strcmp(entry->str, span->str) == 0
+        && strcmp(entry->fontname, font->name) == 0
+        && entry->fontsize == font->size && entry->flags == font->flags;
+}
+
+void textspan_cache_enable(GVC_t *gvc, bool enable) {
+    textspan_cache_t *cache = gvc->textspan_cache;
+    cache_lock(cache);
+    cache->disabled = !enable;
+    if (!enable)
+        textspan_cache_clear(cache);
+    cache_unlock(cache);
+}
+
+void textspan_cache_renderer(GVC_t *gvc, int render_flags) {
+    textspan_cache_t *cache = gvc->textspan_cache;
+    if (!(render_flags & GVRENDER_DRAWS_TEXT_LAYOUT))
+        return;
+    cache_lock(cache);
+    if (!cache->layouts_drawn) {
+        cache->layouts_drawn = true;
+        textspan_cache_clear(cache);
+    }
+    cache_unlock(cache);
+}
+
+void textspan_cache_stats(GVC_t *gvc, size_t *hits, size_t *misses) {
+    textspan_cache_t *cache = gvc->textspan_cache;
+    *hits = COUNTER_LOAD(&cache->hits);
+    *misses = COUNTER_LOAD(&cache->misses);
 }
 
 pointf textspan_size(GVC_t *gvc, textspan_t * span)
@@ -79,6 +220,8 @@ pointf textspan_size(GVC_t *gvc, textspan_t * span)
 {
     char **fpp = NULL, *fontpath = NULL;
     textfont_t *font;
+    textspan_cache_t *cache = gvc->textspan_cache;
+    textspan_cache_entry_t *entry = NULL;
 
     assert(span->font);
     font = span->font;
@@ -92,8 +235,57 @@ pointf textspan_size(GVC_t *gvc, textspan_t * span)
     if (Verbose && emit_once(font->name))
 	fpp = &fontpath;
 
+    /* the first span in a font is always measured, to report its resolution */
+    if (!fpp) {
+	cache_lock(cache);
+	entry = textspan_cache_entry(cache, span);
+	if (entry && textspan_cache_match(entry, span)) {
+	    /* renderers that draw from a layout make one when the span is
+	     * drawn, with their own text layout or with textspan_layout */
+	    span->layout = NULL;
+	    span->free_layout = NULL;
+	    span->size = entry->size;
+	    span->yoffset_layout = entry->yoffset_layout;
+	    span->yoffset_centerline = entry->yoffset_centerline;
+	    cache_unlock(cache);
+	    COUNTER_ADD(&cache->hits, 1);
+	    gv_count("text_cache_hits", 1);
+	    return span->size;
+	}
+	cache_unlock(cache);
+    }
+
+    const bool profiling = gv_profiling();
+    const double start = profiling ? gv_clock() : 0;
     if (! gvtextlayout(gvc, span, fpp))
 	estimate_textspan_size(span, fpp);
+    if (profiling) {
+	gv_count("text_layouts", 1);
+	gv_count("text_layout_seconds", gv_clock() - start);
+    }
+
+    if (entry) {
+	/* the cache may have been disabled while the span was measured */
+	COUNTER_ADD(&cache->misses, 1);
+	char *str = gv_strdup(span->str);
+	char *fontname = gv_strdup(font->name);
+	cache_lock(cache);
+	if (entry == textspan_cache_entry(cache, span)) {
+	    free(entry->str);
+	    free(entry->fontname);
+	    entry->str = str;
+	    entry->fontname = fontname;
+	    entry->fontsize = font->size;
+	    entry->flags = font->flags;
+	    entry->size = span->size;
+	    entry->yoffset_layout = span->yoffset_layout;
+	    entry->yoffset_centerline = span->yoffset_centerline;
+	    str = fontname = NULL;
+	}
+	cache_unlock(cache);
+	free(str);
+	free(fontname);
+    }
 
     if (fpp) {
 	if (fontpath)
@@ -106,6 +298,21 @@ pointf textspan_size(GVC_t *gvc, textspan_t * span)
     return span->size;
 }
 
+void textspan_layout(GVC_t *gvc, textspan_t *span)
+/// Gives a span sized from the cache the layout the text layout plugin makes,
+/// leaving its size and offsets as they were.
+{
+    textspan_t measured;
+
+    if (span->layout)
+	return;
+    measured = *span;
+    if (gvtextlayout(gvc, &measured, NULL)) {
+	span->layout = measured.layout;
+	span->free_layout = measured.free_layout;
+    }
+}
+
 static void *textfont_makef(void *obj, Dtdisc_t *disc) {
     (void)disc;
 
@@ -164,9 +371,20 @@ static int textfont_comparf (Dt_t* dt, void* key1, void* key2, Dtdisc_t* disc)
 void textfont_dict_open(GVC_t *gvc) {
     DTDISC(&gvc->textfont_disc, 0, sizeof(textfont_t), -1, textfont_makef, textfont_freef, textfont_comparf, NULL);
     gvc->textfont_dt = dtopen(&(gvc->textfont_disc), Dtoset);
+    gvc->textspan_cache = gv_alloc(sizeof(textspan_cache_t));
 }
 
 void textfont_dict_close(GVC_t *gvc)
 {
     dtclose(gvc->textfont_dt);
+
+    textspan_cache_t *cache = gvc->textspan_cache;
+    if (cache) {
+	if (Verbose)
+	    fprintf(stderr, "text span cache: %zu hits, %zu misses\n",
+		    cache->hits, cache->misses);
+	textspan_cache_clear(cache);
+	free(cache);
+	gvc->textspan_cache = NULL;
+    }
 }
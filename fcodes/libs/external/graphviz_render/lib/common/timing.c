@@ -13,6 +13,7 @@
 #include	<sys/types.h>
 #include	<sys/times.h>
 #include	<sys/param.h>
+#include	<time.h>
 
 
 
@@ -26,6 +27,7 @@ typedef struct tms mytime_t;
 #else
 
 #include	<time.h>
+#include	<windows.h>
 
 typedef clock_t mytime_t;
 #define GET_TIME(S) S = clock()
@@ -52,3 +54,21 @@ double elapsed_sec(void)
     rv = DIFF_IN_SECS(S, T);
     return rv;
 }
+
+double gv_clock(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+
+    if (frequency.QuadPart == 0)
+	QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#endif
+}
@@ -135,6 +135,8 @@ UTILS_API double drand48(void);
 /* from timing.c */
 UTILS_API void start_timer(void);
 UTILS_API double elapsed_sec(void);
+/// seconds from an arbitrary origin on a monotonic, high resolution clock
+UTILS_API double gv_clock(void);
 
 /* from psusershape.c */
 UTILS_API void cat_libfile(GVJ_t *job, const char **arglib,
@@ -12,6 +12,7 @@
 #include <cgraph/agxbuf.h>
 #include <cgraph/alloc.h>
 #include <time.h>
+#include <common/profile.h>
 #include <dotgen/dot.h>
 #include <pack/pack.h>
 #include <dotgen/aspect.h>
@@ -295,7 +296,9 @@ static void dotLayout(Agraph_t * g)
     dot_init_node_edge(g);
 
     do {
+	gv_span_begin("dot_rank");
         dot_rank(g, asp);
+	gv_span_end();
 	if (maxphase == 1) {
 	    attach_phase_attrs (g, 1);
 	    return;
@@ -305,12 +308,16 @@ static void dotLayout(Agraph_t * g)
 	    asp = NULL;
 	    aspect.nextIter = 0;
 	}
+	gv_span_begin("dot_mincross");
         dot_mincross(g, (asp != NULL));
+	gv_span_end();
 	if (maxphase == 2) {
 	    attach_phase_attrs (g, 2);
 	    return;
 	}
+	gv_span_begin("dot_position");
         dot_position(g, asp);
+	gv_span_end();
 	if (maxphase == 3) {
 	    attach_phase_attrs (g, 2);  /* positions will be attached on output */
 	    return;
@@ -319,8 +326,12 @@ static void dotLayout(Agraph_t * g)
     } while (aspect.nextIter && aspect.nPasses);
     if (GD_flags(g) & NEW_RANK)
 	removeFill (g);
+    gv_span_begin("dot_sameports");
     dot_sameports(g);
+    gv_span_end();
+    gv_span_begin("dot_splines");
     dot_splines(g);
+    gv_span_end();
     if (mapbool(agget(g, "compound")))
 	dot_compoundEdges(g);
 }
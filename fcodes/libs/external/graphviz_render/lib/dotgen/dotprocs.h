@@ -74,6 +74,10 @@ extern "C" {
     extern void dot_rank(Agraph_t *, aspect_t*);
     extern void dot_sameports(Agraph_t *);
     extern void dot_splines(Agraph_t *);
+
+    extern bool dot_incremental(Agraph_t *);
+    extern void dot_warm_ranks(Agraph_t *);
+    extern bool dot_warm_order(Agraph_t *);
 #undef extern
 
 #ifdef __cplusplus
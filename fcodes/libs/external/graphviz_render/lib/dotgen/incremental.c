@@ -0,0 +1,311 @@
+/**
+ * @file
+ * @brief warm start of dot layouts from a previous layout
+ *
+ * When the graph attribute `incremental` is true, nodes that carry a `pos`
+ * attribute, for example from earlier `-Tdot` output, seed the ranking and
+ * the initial order of crossing minimization. Nodes added since then are
+ * placed next to their neighbors. Both phases then optimize as usual from
+ * that starting point, so existing nodes tend to keep their relative
+ * placement and the optimizers converge in fewer iterations.
+ */
+
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#include <cgraph/alloc.h>
+#include <dotgen/dot.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// positions closer than this along the rank axis are taken to be one rank
+#define RANK_TOLERANCE 0.5
+
+/* states of a node in ND_mark while seeding ranks */
+#define UNRANKED 0
+#define FIXED 1    ///< rank taken from the previous layout
+#define DERIVED 2  ///< rank derived from neighbors
+
+bool dot_incremental(graph_t *g) {
+  return mapbool(agget(dot_root(g), "incremental"));
+}
+
+/// previous position of a real node along the rank and order axes
+static bool prev_coord(node_t *n, attrsym_t *pos, int rankdir, double *rank_key,
+                       double *order_key) {
+  if (ND_node_type(n) != NORMAL) {
+    return false;
+  }
+  double x, y;
+  if (sscanf(agxget(n, pos), "%lf,%lf", &x, &y) != 2) {
+    return false;
+  }
+  switch (rankdir) {
+  case RANKDIR_LR:
+    *rank_key = x;
+    *order_key = y;
+    break;
+  case RANKDIR_BT:
+    *rank_key = y;
+    *order_key = x;
+    break;
+  case RANKDIR_RL:
+    *rank_key = -x;
+    *order_key = y;
+    break;
+  default: // RANKDIR_TB
+    *rank_key = -y;
+    *order_key = x;
+    break;
+  }
+  return true;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  const double *x = a;
+  const double *y = b;
+  if (*x < *y) {
+    return -1;
+  }
+  if (*x > *y) {
+    return 1;
+  }
+  return 0;
+}
+
+/// index of the level containing `key`
+static int level_of(const double *levels, size_t n_levels, double key) {
+  size_t lo = 0;
+  size_t hi = n_levels;
+  while (lo + 1 < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (levels[mid] <= key + RANK_TOLERANCE) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return (int)lo;
+}
+
+/// derive ranks of new nodes from already ranked neighbors
+///
+/// The fast graph is acyclic at this point, so each direction reaches a fixed
+/// point after at most as many rounds as there are nodes.
+static void propagate(graph_t *g, size_t n_nodes, bool forward) {
+  bool changed = true;
+  for (size_t round = 0; changed && round < n_nodes; ++round) {
+    changed = false;
+    for (size_t c = 0; c < GD_comp(g).size; c++) {
+      for (node_t *n = GD_comp(g).list[c]; n; n = ND_next(n)) {
+        edge_t *e;
+        for (size_t i = 0; (e = ND_out(n).list[i]); i++) {
+          node_t *t = agtail(e);
+          node_t *h = aghead(e);
+          if (forward && ND_mark(t) != UNRANKED && ND_mark(h) != FIXED) {
+            const int r = ND_rank(t) + ED_minlen(e);
+            if (ND_mark(h) == UNRANKED || r > ND_rank(h)) {
+              ND_rank(h) = r;
+              ND_mark(h) = DERIVED;
+              changed = true;
+            }
+          } else if (!forward && ND_mark(h) != UNRANKED &&
+                     ND_mark(t) != FIXED) {
+            const int r = ND_rank(h) - ED_minlen(e);
+            if (ND_mark(t) == UNRANKED || r < ND_rank(t)) {
+              ND_rank(t) = r;
+              ND_mark(t) = DERIVED;
+              changed = true;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+void dot_warm_ranks(graph_t *g) {
+  attrsym_t *pos = agattr(g, AGNODE, "pos", NULL);
+  if (pos == NULL) {
+    return;
+  }
+  const int rankdir = GD_rankdir(g);
+
+  size_t n_nodes = 0;
+  for (size_t c = 0; c < GD_comp(g).size; c++) {
+    for (node_t *n = GD_comp(g).list[c]; n; n = ND_next(n)) {
+      ++n_nodes;
+    }
+  }
+
+  // distinct positions along the rank axis, one per previous rank
+  double *levels = gv_calloc(n_nodes, sizeof(double));
+  size_t n_levels = 0;
+  for (size_t c = 0; c < GD_comp(g).size; c++) {
+    for (node_t *n = GD_comp(g).list[c]; n; n = ND_next(n)) {
+      double rank_key, order_key;
+      if (prev_coord(n, pos, rankdir, &rank_key, &order_key)) {
+        levels[n_levels++] = rank_key;
+      }
+    }
+  }
+  if (n_levels == 0) {
+    free(levels);
+    return;
+  }
+  qsort(levels, n_levels, sizeof(levels[0]), cmp_double);
+  size_t distinct = 1;
+  for (size_t i = 1; i < n_levels; ++i) {
+    if (levels[i] - levels[distinct - 1] > RANK_TOLERANCE) {
+      levels[distinct++] = levels[i];
+    }
+  }
+
+  // edge labels occupy a rank of their own between their endpoints
+  const int scale = (GD_has_labels(g) & EDGE_LABEL) ? 2 : 1;
+
+  for (size_t c = 0; c < GD_comp(g).size; c++) {
+    for (node_t *n = GD_comp(g).list[c]; n; n = ND_next(n)) {
+      double rank_key, order_key;
+      if (prev_coord(n, pos, rankdir, &rank_key, &order_key)) {
+        ND_rank(n) = scale * level_of(levels, distinct, rank_key);
+        ND_mark(n) = FIXED;
+      } else {
+        ND_rank(n) = 0;
+        ND_mark(n) = UNRANKED;
+      }
+    }
+  }
+  free(levels);
+
+  // new descendants go below their ancestors, then new ancestors above their
+  // descendants
+  propagate(g, n_nodes, true);
+  propagate(g, n_nodes, false);
+
+  // Anything still unranked is in a component with no previous layout. Its
+  // ranks are left infeasible, so network simplex computes them from scratch.
+  for (size_t c = 0; c < GD_comp(g).size; c++) {
+    for (node_t *n = GD_comp(g).list[c]; n; n = ND_next(n)) {
+      ND_mark(n) = FALSE;
+    }
+  }
+}
+
+/// previous position of a node along the order axis
+///
+/// Virtual nodes are placed on the line between the endpoints of the edge they
+/// belong to.
+static bool order_key(node_t *n, attrsym_t *pos, int rankdir, double *key) {
+  double rank_key;
+  if (ND_node_type(n) == NORMAL) {
+    return prev_coord(n, pos, rankdir, &rank_key, key);
+  }
+
+  edge_t *e = NULL;
+  if (ND_out(n).size > 0) {
+    e = ND_out(n).list[0];
+  } else if (ND_in(n).size > 0) {
+    e = ND_in(n).list[0];
+  }
+  while (e && ED_to_orig(e)) {
+    e = ED_to_orig(e);
+  }
+  if (e == NULL) {
+    return false;
+  }
+
+  node_t *t = agtail(e);
+  node_t *h = aghead(e);
+  double kt, kh;
+  if (!prev_coord(t, pos, rankdir, &rank_key, &kt) ||
+      !prev_coord(h, pos, rankdir, &rank_key, &kh)) {
+    return false;
+  }
+  if (ND_rank(t) == ND_rank(h)) {
+    *key = kt;
+  } else {
+    *key = kt + (kh - kt) * (ND_rank(n) - ND_rank(t)) /
+                    (double)(ND_rank(h) - ND_rank(t));
+  }
+  return true;
+}
+
+typedef struct {
+  node_t *node;
+  double key;
+  int order; ///< position before sorting, to keep the sort stable
+} keyed_node_t;
+
+static int cmp_keyed(const void *a, const void *b) {
+  const keyed_node_t *x = a;
+  const keyed_node_t *y = b;
+  if (x->key < y->key) {
+    return -1;
+  }
+  if (x->key > y->key) {
+    return 1;
+  }
+  return (x->order > y->order) - (x->order < y->order);
+}
+
+bool dot_warm_order(graph_t *g) {
+  attrsym_t *pos = agattr(g, AGNODE, "pos", NULL);
+  if (pos == NULL) {
+    return false;
+  }
+  const int rankdir = GD_rankdir(g);
+  bool any = false;
+
+  for (int r = GD_minrank(g); r <= GD_maxrank(g); r++) {
+    rank_t *rank = &GD_rank(g)[r];
+    if (rank->n < 2) {
+      continue;
+    }
+    keyed_node_t *items = gv_calloc((size_t)rank->n, sizeof(keyed_node_t));
+    bool have_key = false;
+    double last = 0;
+    for (int i = 0; i < rank->n; i++) {
+      double key;
+      items[i].node = rank->v[i];
+      items[i].order = i;
+      if (order_key(rank->v[i], pos, rankdir, &key)) {
+        // nodes before the first keyed one stay in front of it
+        if (!have_key) {
+          for (int j = 0; j < i; j++) {
+            items[j].key = key;
+          }
+        }
+        have_key = true;
+        last = key;
+      }
+      // new nodes stay behind their predecessor in the current order
+      items[i].key = last;
+    }
+    if (have_key) {
+      any = true;
+      qsort(items, (size_t)rank->n, sizeof(items[0]), cmp_keyed);
+      for (int i = 0; i < rank->n; i++) {
+        rank->v[i] = items[i].node;
+        ND_order(items[i].node) = i;
+      }
+    }
+    free(items);
+  }
+
+  if (any) {
+    for (int r = GD_minrank(g); r <= GD_maxrank(g); r++) {
+      GD_rank(g)[r].valid = false;
+    }
+  }
+  return any;
+}
@@ -21,6 +21,7 @@
 #include <cgraph/alloc.h>
 #include <cgraph/cgraph.h>
 #include <cgraph/exit.h>
+#include <common/profile.h>
 #include <dotgen/dot.h>
 #include <limits.h>
 #include <stdbool.h>
@@ -38,23 +39,50 @@ struct adjmatrix_t {
 #define saveorder(v)	(ND_coord(v)).x
 #define flatindex(v)	((size_t)ND_low(v))
 
+/// end of an edge on a neighboring rank
+typedef struct {
+    int order;   ///< position of the node on that rank
+    double port; ///< x coordinate of the port on that node
+    int weight;  ///< crossing penalty of the edge
+} edge_end_t;
+
+/// state of a single crossing minimization run
+typedef struct {
+  graph_t *Root;
+  int GlobalMinRank, GlobalMaxRank;
+  edge_t **TE_list;
+  int *TI_list;
+  bool ReMincross;
+  bool Incremental; ///< start from the order of a previous layout
+  /* scratch space of sorted_cross, grown as needed */
+  edge_end_t *Ends;
+  int *Suffix;
+  size_t EndsSize;
+  /* mincross parameters */
+  int MinQuit;
+  int MaxIter;
+  double Convergence;
+} mincross_ctx_t;
+
 	/* forward declarations */
-static bool medians(graph_t * g, int r0, int r1);
+static bool medians(mincross_ctx_t *ctx, graph_t * g, int r0, int r1);
 static int nodeposcmpf(node_t ** n0, node_t ** n1);
 static int edgeidcmpf(edge_t ** e0, edge_t ** e1);
 static void flat_breakcycles(graph_t * g);
-static void flat_reorder(graph_t * g);
+static void flat_reorder(mincross_ctx_t *ctx, graph_t * g);
 static void flat_search(graph_t * g, node_t * v);
-static void init_mincross(graph_t * g);
-static void merge2(graph_t * g);
+static void init_mincross(mincross_ctx_t *ctx, graph_t * g);
+static void merge2(mincross_ctx_t *ctx, graph_t * g);
 static void init_mccomp(graph_t *g, size_t c);
-static void cleanup2(graph_t * g, int nc);
-static int mincross_clust(graph_t * g, int);
-static int mincross(graph_t * g, int startpass, int endpass, int);
-static void mincross_step(graph_t * g, int pass);
-static void mincross_options(graph_t * g);
+static void cleanup2(mincross_ctx_t *ctx, graph_t * g, int nc);
+static int mincross_clust(mincross_ctx_t *ctx, graph_t * g, int);
+static int mincross(mincross_ctx_t *ctx, graph_t * g, int startpass,
+                    int endpass, int);
+static void mincross_step(mincross_ctx_t *ctx, graph_t * g, int pass);
+static void mincross_options(mincross_ctx_t *ctx, graph_t * g);
 static void save_best(graph_t * g);
-static void restore_best(graph_t * g);
+static void restore_best(mincross_ctx_t *ctx, graph_t * g);
+static void transpose(mincross_ctx_t *ctx, graph_t * g, bool reverse);
 static adjmatrix_t *new_matrix(size_t i, size_t j);
 static void free_matrix(adjmatrix_t * p);
 static int ordercmpf(int *i0, int *i1);
@@ -66,22 +94,12 @@ static rank_t *gd_rank(Agraph_t *g, int r) {return &GD_rank(g)[r];}
 static int nd_order(Agnode_t *v) { return ND_order(v); }
 #endif
 void check_rs(graph_t * g, int null_ok);
-void check_order(void);
+void check_order(graph_t *g);
 void check_vlists(graph_t * g);
 void node_in_root_vlist(node_t * n);
 #endif
 
 
-	/* mincross parameters */
-static int MinQuit;
-static double Convergence;
-
-static graph_t *Root;
-static int GlobalMinRank, GlobalMaxRank;
-static edge_t **TE_list;
-static int *TI_list;
-static bool ReMincross;
-
 #if defined(DEBUG) && DEBUG > 1
 static void indent(graph_t* g)
 {
@@ -363,35 +381,37 @@ void dot_mincross(graph_t * g, int doBalance)
 	}
     }
 
-    init_mincross(g);
+    mincross_ctx_t ctx = {0};
+    init_mincross(&ctx, g);
 
     size_t comp;
     for (nc = 0, comp = 0; comp < GD_comp(g).size; comp++) {
 	init_mccomp(g, comp);
-	nc += mincross(g, 0, 2, doBalance);
+	nc += mincross(&ctx, g, 0, 2, doBalance);
     }
 
-    merge2(g);
+    merge2(&ctx, g);
 
     /* run mincross on contents of each cluster */
     for (int c = 1; c <= GD_n_cluster(g); c++) {
-	nc += mincross_clust(GD_clust(g)[c], doBalance);
+	nc += mincross_clust(&ctx, GD_clust(g)[c], doBalance);
 #ifdef DEBUG
 	check_vlists(GD_clust(g)[c]);
-	check_order();
+	check_order(g);
 #endif
     }
 
     if (GD_n_cluster(g) > 0 && (!(s = agget(g, "remincross")) || mapbool(s))) {
 	mark_lowclusters(g);
-	ReMincross = true;
-	nc = mincross(g, 2, 2, doBalance);
+	ctx.ReMincross = true;
+	nc = mincross(&ctx, g, 2, 2, doBalance);
 #ifdef DEBUG
 	for (int c = 1; c <= GD_n_cluster(g); c++)
 	    check_vlists(GD_clust(g)[c]);
 #endif
     }
-    cleanup2(g, nc);
+    gv_count("mincross_crossings", nc);
+    cleanup2(&ctx, g, nc);
 }
 
 static adjmatrix_t *new_matrix(size_t i, size_t j) {
@@ -431,11 +451,12 @@ static int betweenclust(edge_t * e)
     return (ND_clust(agtail(e)) != ND_clust(aghead(e)));
 }
 
-static void do_ordering_node(graph_t *g, node_t *n, bool outflag) {
+static void do_ordering_node(mincross_ctx_t *ctx, graph_t *g, node_t *n,
+                             bool outflag) {
     int i, ne;
     node_t *u, *v;
     edge_t *e, *f, *fe;
-    edge_t **sortlist = TE_list;
+    edge_t **sortlist = ctx->TE_list;
 
     if (ND_clust(n))
 	return;
@@ -471,16 +492,16 @@ static void do_ordering_node(graph_t *g, node_t *n, bool outflag) {
     }
 }
 
-static void do_ordering(graph_t *g, bool outflag) {
+static void do_ordering(mincross_ctx_t *ctx, graph_t *g, bool outflag) {
     /* Order all nodes in graph */
     node_t *n;
 
     for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
-	do_ordering_node (g, n, outflag);
+	do_ordering_node (ctx, g, n, outflag);
     }
 }
 
-static void do_ordering_for_nodes(graph_t * g)
+static void do_ordering_for_nodes(mincross_ctx_t *ctx, graph_t * g)
 {
     /* Order nodes which have the "ordered" attribute */
     node_t *n;
@@ -489,9 +510,9 @@ static void do_ordering_for_nodes(graph_t * g)
     for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
 	if ((ordering = late_string(n, N_ordering, NULL))) {
 	    if (streq(ordering, "out"))
-		do_ordering_node(g, n, true);
+		do_ordering_node(ctx, g, n, true);
 	    else if (streq(ordering, "in"))
-		do_ordering_node(g, n, false);
+		do_ordering_node(ctx, g, n, false);
 	    else if (ordering[0])
 		agerr(AGERR, "ordering '%s' not recognized for node '%s'.\n", ordering, agnameof(n));
 	}
@@ -505,7 +526,7 @@ static void do_ordering_for_nodes(graph_t * g)
  * Note that, in this implementation, the value of G_ordering
  * dominates the value of N_ordering.
  */
-static void ordered_edges(graph_t * g)
+static void ordered_edges(mincross_ctx_t *ctx, graph_t * g)
 {
     char *ordering;
 
@@ -513,9 +534,9 @@ static void ordered_edges(graph_t * g)
 	return;
     if ((ordering = late_string(g, G_ordering, NULL))) {
 	if (streq(ordering, "out"))
-	    do_ordering(g, true);
+	    do_ordering(ctx, g, true);
 	else if (streq(ordering, "in"))
-	    do_ordering(g, false);
+	    do_ordering(ctx, g, false);
 	else if (ordering[0])
 	    agerr(AGERR, "ordering '%s' not recognized.\n", ordering);
     }
@@ -526,34 +547,35 @@ static void ordered_edges(graph_t * g)
 	for (subg = agfstsubg(g); subg; subg = agnxtsubg(subg)) {
 	    /* clusters are processed by separate calls to ordered_edges */
 	    if (!is_cluster(subg))
-		ordered_edges(subg);
+		ordered_edges(ctx, subg);
 	}
-	if (N_ordering) do_ordering_for_nodes (g);
+	if (N_ordering) do_ordering_for_nodes (ctx, g);
     }
 }
 
-static int mincross_clust(graph_t * g, int doBalance)
+static int mincross_clust(mincross_ctx_t *ctx, graph_t * g, int doBalance)
 {
     int c, nc;
 
     expand_cluster(g);
-    ordered_edges(g);
+    ordered_edges(ctx, g);
     flat_breakcycles(g);
-    flat_reorder(g);
-    nc = mincross(g, 2, 2, doBalance);
+    flat_reorder(ctx, g);
+    nc = mincross(ctx, g, 2, 2, doBalance);
 
     for (c = 1; c <= GD_n_cluster(g); c++)
-	nc += mincross_clust(GD_clust(g)[c], doBalance);
+	nc += mincross_clust(ctx, GD_clust(g)[c], doBalance);
 
     save_vlist(g);
     return nc;
 }
 
-static bool left2right(graph_t *g, node_t *v, node_t *w) {
+static bool left2right(const mincross_ctx_t *ctx, graph_t *g, node_t *v,
+                       node_t *w) {
     adjmatrix_t *M;
 
     /* CLUSTER indicates orig nodes of clusters, and vnodes of skeletons */
-    if (!ReMincross) {
+    if (!ctx->ReMincross) {
 	if (ND_clust(v) != ND_clust(w) && ND_clust(v) && ND_clust(w)) {
 	    /* the following allows cluster skeletons to be swapped */
 	    if (ND_ranktype(v) == CLUSTER && ND_node_type(v) == VIRTUAL)
@@ -577,11 +599,82 @@ static bool left2right(graph_t *g, node_t *v, node_t *w) {
     return ELT(M, flatindex(v), flatindex(w)) != 0;
 }
 
-static int in_cross(node_t * v, node_t * w)
+/* Above this product of degrees, in_cross and out_cross sort the edges of
+ * one node instead of comparing every pair.
+ */
+#define SMALL_DEGREE_PRODUCT 64
+
+static int edge_end_cmp(const edge_end_t *a, const edge_end_t *b)
+{
+    if (a->order != b->order)
+	return a->order < b->order ? -1 : 1;
+    if (a->port != b->port)
+	return a->port < b->port ? -1 : 1;
+    return 0;
+}
+
+static edge_end_t edge_end(edge_t *e, bool tail)
+{
+    if (tail)
+	return (edge_end_t){.order = ND_order(agtail(e)),
+	                    .port = ED_tail_port(e).p.x,
+	                    .weight = ED_xpenalty(e)};
+    return (edge_end_t){.order = ND_order(aghead(e)),
+                        .port = ED_head_port(e).p.x,
+                        .weight = ED_xpenalty(e)};
+}
+
+/* sorted_cross:
+ * Weighted number of crossings between the edges in lv and lw when the node
+ * owning lv is placed left of the node owning lw, i.e. of pairs whose far
+ * end in lv lies right of the far end in lw. Edge ends are taken at the tail
+ * if tail is set, else at the head. Runs in O((|lv| + |lw|) log |lv|).
+ */
+static int sorted_cross(mincross_ctx_t *ctx, elist lv, elist lw, bool tail)
+{
+    if (ctx->EndsSize < lv.size) {
+	ctx->Ends = gv_recalloc(ctx->Ends, ctx->EndsSize, lv.size,
+	                        sizeof(edge_end_t));
+	ctx->Suffix = gv_recalloc(ctx->Suffix, ctx->EndsSize + 1, lv.size + 1,
+	                          sizeof(int));
+	ctx->EndsSize = lv.size;
+    }
+    edge_end_t *ends = ctx->Ends;
+    int *suffix = ctx->Suffix;
+    int cross = 0;
+
+    suffix[lv.size] = 0;
+
+    for (size_t i = 0; i < lv.size; i++)
+	ends[i] = edge_end(lv.list[i], tail);
+    qsort(ends, lv.size, sizeof(ends[0]), (qsort_cmpf)edge_end_cmp);
+    for (size_t i = lv.size; i > 0; i--)
+	suffix[i - 1] = suffix[i] + ends[i - 1].weight;
+
+    for (size_t i = 0; i < lw.size; i++) {
+	const edge_end_t end = edge_end(lw.list[i], tail);
+	/* first end strictly right of this one */
+	size_t lo = 0, hi = lv.size;
+	while (lo < hi) {
+	    const size_t mid = lo + (hi - lo) / 2;
+	    if (edge_end_cmp(&ends[mid], &end) > 0)
+		hi = mid;
+	    else
+		lo = mid + 1;
+	}
+	cross += suffix[lo] * end.weight;
+    }
+    return cross;
+}
+
+static int in_cross(mincross_ctx_t *ctx, node_t * v, node_t * w)
 {
     edge_t **e1, **e2;
     int inv, cross = 0, t;
 
+    if (ND_in(v).size * ND_in(w).size > SMALL_DEGREE_PRODUCT)
+	return sorted_cross(ctx, ND_in(v), ND_in(w), true);
+
     for (e2 = ND_in(w).list; *e2; e2++) {
 	int cnt = ED_xpenalty(*e2);		
 		
@@ -596,11 +689,14 @@ static int in_cross(node_t * v, node_t * w)
     return cross;
 }
 
-static int out_cross(node_t * v, node_t * w)
+static int out_cross(mincross_ctx_t *ctx, node_t * v, node_t * w)
 {
     edge_t **e1, **e2;
     int inv, cross = 0, t;
 
+    if (ND_out(v).size * ND_out(w).size > SMALL_DEGREE_PRODUCT)
+	return sorted_cross(ctx, ND_out(v), ND_out(w), false);
+
     for (e2 = ND_out(w).list; *e2; e2++) {
 	int cnt = ED_xpenalty(*e2);
 	inv = ND_order(aghead(*e2));
@@ -615,7 +711,7 @@ static int out_cross(node_t * v, node_t * w)
 
 }
 
-static void exchange(node_t * v, node_t * w)
+static void exchange(graph_t *root, node_t * v, node_t * w)
 {
     int vi, wi, r;
 
@@ -623,12 +719,13 @@ static void exchange(node_t * v, node_t * w)
     vi = ND_order(v);
     wi = ND_order(w);
     ND_order(v) = wi;
-    GD_rank(Root)[r].v[wi] = v;
+    GD_rank(root)[r].v[wi] = v;
     ND_order(w) = vi;
-    GD_rank(Root)[r].v[vi] = w;
+    GD_rank(root)[r].v[vi] = w;
 }
 
-static void balanceNodes(graph_t * g, int r, node_t * v, node_t * w)
+static void balanceNodes(mincross_ctx_t *ctx, graph_t * g, int r, node_t * v,
+                         node_t * w)
 {
     node_t *s;			/* separator node */
     int sepIndex = 0;
@@ -687,7 +784,7 @@ static void balanceNodes(graph_t * g, int r, node_t * v, node_t * w)
 
     /* now exchange v,w and calculate the same counts */
 
-    exchange(v, w);
+    exchange(ctx->Root, v, w);
 
     /* get the separator node index */
     for (i = 0; i < GD_rank(g)[r].n; i++) {
@@ -713,11 +810,11 @@ static void balanceNodes(graph_t * g, int r, node_t * v, node_t * w)
     }
 
     if (abs(k1 - m1) > abs(k - m)) {
-	exchange(v, w);		//revert to the original ordering
+	exchange(ctx->Root, v, w);		//revert to the original ordering
     }
 }
 
-static int balance(graph_t * g)
+static int balance(mincross_ctx_t *ctx, graph_t * g)
 {
     int i, c0, c1, rv;
     node_t *v, *w;
@@ -732,28 +829,29 @@ static int balance(graph_t * g)
 	    v = GD_rank(g)[r].v[i];
 	    w = GD_rank(g)[r].v[i + 1];
 	    assert(ND_order(v) < ND_order(w));
-	    if (left2right(g, v, w))
+	    if (left2right(ctx, g, v, w))
 		continue;
 	    c0 = c1 = 0;
 	    if (r > 0) {
-		c0 += in_cross(v, w);
-		c1 += in_cross(w, v);
+		c0 += in_cross(ctx, v, w);
+		c1 += in_cross(ctx, w, v);
 	    }
 
 	    if (GD_rank(g)[r + 1].n > 0) {
-		c0 += out_cross(v, w);
-		c1 += out_cross(w, v);
+		c0 += out_cross(ctx, v, w);
+		c1 += out_cross(ctx, w, v);
 	    }
 
 	    if (c1 <= c0) {
-		balanceNodes(g, r, v, w);
+		balanceNodes(ctx, g, r, v, w);
 	    }
 	}
     }
     return rv;
 }
 
-static int transpose_step(graph_t * g, int r, bool reverse)
+static int transpose_step(mincross_ctx_t *ctx, graph_t * g, int r,
+                          bool reverse)
 {
     int i, c0, c1, rv;
     node_t *v, *w;
@@ -764,29 +862,29 @@ static int transpose_step(graph_t * g, int r, bool reverse)
 	v = GD_rank(g)[r].v[i];
 	w = GD_rank(g)[r].v[i + 1];
 	assert(ND_order(v) < ND_order(w));
-	if (left2right(g, v, w))
+	if (left2right(ctx, g, v, w))
 	    continue;
 	c0 = c1 = 0;
 	if (r > 0) {
-	    c0 += in_cross(v, w);
-	    c1 += in_cross(w, v);
+	    c0 += in_cross(ctx, v, w);
+	    c1 += in_cross(ctx, w, v);
 	}
 	if (GD_rank(g)[r + 1].n > 0) {
-	    c0 += out_cross(v, w);
-	    c1 += out_cross(w, v);
+	    c0 += out_cross(ctx, v, w);
+	    c1 += out_cross(ctx, w, v);
 	}
 	if (c1 < c0 || (c0 > 0 && reverse && c1 == c0)) {
-	    exchange(v, w);
+	    exchange(ctx->Root, v, w);
 	    rv += c0 - c1;
-	    GD_rank(Root)[r].valid = false;
+	    GD_rank(ctx->Root)[r].valid = false;
 	    GD_rank(g)[r].candidate = true;
 
 	    if (r > GD_minrank(g)) {
-		GD_rank(Root)[r - 1].valid = false;
+		GD_rank(ctx->Root)[r - 1].valid = false;
 		GD_rank(g)[r - 1].candidate = true;
 	    }
 	    if (r < GD_maxrank(g)) {
-		GD_rank(Root)[r + 1].valid = false;
+		GD_rank(ctx->Root)[r + 1].valid = false;
 		GD_rank(g)[r + 1].candidate = true;
 	    }
 	}
@@ -794,7 +892,13 @@ static int transpose_step(graph_t * g, int r, bool reverse)
     return rv;
 }
 
-static void transpose(graph_t * g, bool reverse)
+/* transpose:
+ * Ranks are swept top to bottom, and each step sees the exchanges already
+ * made on the rank above it. Transposing the even and then the odd ranks in
+ * parallel would make different exchanges, changing the layout of most graphs
+ * with crossings, and making it depend on whether dot was built with OpenMP.
+ */
+static void transpose(mincross_ctx_t *ctx, graph_t * g, bool reverse)
 {
     int r, delta;
 
@@ -804,16 +908,18 @@ static void transpose(graph_t * g, bool reverse)
 	delta = 0;
 	for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
 	    if (GD_rank(g)[r].candidate) {
-		delta += transpose_step(g, r, reverse);
+		delta += transpose_step(ctx, g, r, reverse);
 	    }
 	}
     } while (delta >= 1);
 }
 
-static int mincross(graph_t * g, int startpass, int endpass, int doBalance)
+static int mincross(mincross_ctx_t *ctx, graph_t * g, int startpass,
+                    int endpass, int doBalance)
 {
     int maxthispass = 0, iter, trying, pass;
     int cur_cross, best_cross;
+    bool warm = false;
 
     if (startpass > 1) {
 	cur_cross = best_cross = ncross(g);
@@ -821,22 +927,43 @@ static int mincross(graph_t * g, int startpass, int endpass, int doBalance)
     } else
 	cur_cross = best_cross = INT_MAX;
     for (pass = startpass; pass <= endpass; pass++) {
+	if (pass == 1 && warm)
+	    continue;
+	gv_count("mincross_passes", 1);
 	if (pass <= 1) {
-	    maxthispass = MIN(4, MaxIter);
-	    if (g == dot_root(g))
+	    maxthispass = MIN(4, ctx->MaxIter);
+	    if (g == dot_root(g)) {
 		build_ranks(g, pass);
+		if (ncross(g) > 0)
+		    transpose(ctx, g, false);
+	    }
 	    if (pass == 0)
 		flat_breakcycles(g);
-	    flat_reorder(g);
+	    flat_reorder(ctx, g);
 
 	    if ((cur_cross = ncross(g)) <= best_cross) {
 		save_best(g);
 		best_cross = cur_cross;
 	    }
+
+	    /* Try the order of the previous layout. It replaces the second
+	     * initial order if it has no more crossings than the first. */
+	    if (pass == 0 && ctx->Incremental && g == dot_root(g)
+		&& dot_warm_order(g)) {
+		flat_reorder(ctx, g);
+		if ((cur_cross = ncross(g)) <= best_cross) {
+		    save_best(g);
+		    best_cross = cur_cross;
+		    warm = true;
+		} else {
+		    restore_best(ctx, g);
+		    cur_cross = best_cross;
+		}
+	    }
 	} else {
-	    maxthispass = MaxIter;
+	    maxthispass = ctx->MaxIter;
 	    if (cur_cross > best_cross)
-		restore_best(g);
+		restore_best(ctx, g);
 	    cur_cross = best_cross;
 	}
 	trying = 0;
@@ -845,14 +972,15 @@ static int mincross(graph_t * g, int startpass, int endpass, int doBalance)
 		fprintf(stderr,
 			"mincross: pass %d iter %d trying %d cur_cross %d best_cross %d\n",
 			pass, iter, trying, cur_cross, best_cross);
-	    if (trying++ >= MinQuit)
+	    if (trying++ >= ctx->MinQuit)
 		break;
 	    if (cur_cross == 0)
 		break;
-	    mincross_step(g, iter);
+	    mincross_step(ctx, g, iter);
+	    gv_count("mincross_iterations", 1);
 	    if ((cur_cross = ncross(g)) <= best_cross) {
 		save_best(g);
-		if (cur_cross < Convergence * best_cross)
+		if (cur_cross < ctx->Convergence * best_cross)
 		    trying = 0;
 		best_cross = cur_cross;
 	    }
@@ -861,20 +989,20 @@ static int mincross(graph_t * g, int startpass, int endpass, int doBalance)
 	    break;
     }
     if (cur_cross > best_cross)
-	restore_best(g);
+	restore_best(ctx, g);
     if (best_cross > 0) {
-	transpose(g, FALSE);
+	transpose(ctx, g, false);
 	best_cross = ncross(g);
     }
     if (doBalance) {
 	for (iter = 0; iter < maxthispass; iter++)
-	    balance(g);
+	    balance(ctx, g);
     }
 
     return best_cross;
 }
 
-static void restore_best(graph_t * g)
+static void restore_best(mincross_ctx_t *ctx, graph_t * g)
 {
     node_t *n;
     int i, r;
@@ -886,7 +1014,7 @@ static void restore_best(graph_t * g)
 	}
     }
     for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
-	GD_rank(Root)[r].valid = false;
+	GD_rank(ctx->Root)[r].valid = false;
 	qsort(GD_rank(g)[r].v, GD_rank(g)[r].n, sizeof(GD_rank(g)[0].v[0]),
 	      (qsort_cmpf) nodeposcmpf);
     }
@@ -905,7 +1033,7 @@ static void save_best(graph_t * g)
 }
 
 /* merges the connected components of g */
-static void merge_components(graph_t * g)
+static void merge_components(mincross_ctx_t *ctx, graph_t * g)
 {
     node_t *u, *v;
 
@@ -924,18 +1052,18 @@ static void merge_components(graph_t * g)
     }
     GD_comp(g).size = 1;
     GD_nlist(g) = GD_comp(g).list[0];
-    GD_minrank(g) = GlobalMinRank;
-    GD_maxrank(g) = GlobalMaxRank;
+    GD_minrank(g) = ctx->GlobalMinRank;
+    GD_maxrank(g) = ctx->GlobalMaxRank;
 }
 
 /* merge connected components, create globally consistent rank lists */
-static void merge2(graph_t * g)
+static void merge2(mincross_ctx_t *ctx, graph_t * g)
 {
     int i, r;
     node_t *v;
 
     /* merge the components and rank limits */
-    merge_components(g);
+    merge_components(ctx, g);
 
     /* install complete ranks */
     for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
@@ -956,20 +1084,21 @@ static void merge2(graph_t * g)
     }
 }
 
-static void cleanup2(graph_t * g, int nc)
+static void cleanup2(mincross_ctx_t *ctx, graph_t * g, int nc)
 {
     int i, j, r, c;
     node_t *v;
     edge_t *e;
 
-    if (TI_list) {
-	free(TI_list);
-	TI_list = NULL;
-    }
-    if (TE_list) {
-	free(TE_list);
-	TE_list = NULL;
-    }
+    free(ctx->TI_list);
+    ctx->TI_list = NULL;
+    free(ctx->TE_list);
+    ctx->TE_list = NULL;
+    free(ctx->Ends);
+    ctx->Ends = NULL;
+    free(ctx->Suffix);
+    ctx->Suffix = NULL;
+    ctx->EndsSize = 0;
     /* fix vlists of clusters */
     for (c = 1; c <= GD_n_cluster(g); c++)
 	rec_reset_vlists(GD_clust(g)[c]);
@@ -996,7 +1125,7 @@ static void cleanup2(graph_t * g, int nc)
 		agnameof(g), nc, elapsed_sec());
 }
 
-static node_t *neighbor(node_t * v, int dir)
+static node_t *neighbor(graph_t *root, node_t * v, int dir)
 {
     node_t *rv;
 
@@ -1004,9 +1133,9 @@ static node_t *neighbor(node_t * v, int dir)
 assert(v);
     if (dir < 0) {
 	if (ND_order(v) > 0)
-	    rv = GD_rank(Root)[ND_rank(v)].v[ND_order(v) - 1];
+	    rv = GD_rank(root)[ND_rank(v)].v[ND_order(v) - 1];
     } else
-	rv = GD_rank(Root)[ND_rank(v)].v[ND_order(v) + 1];
+	rv = GD_rank(root)[ND_rank(v)].v[ND_order(v) + 1];
 assert((rv == 0) || (ND_order(rv)-ND_order(v))*dir > 0);
     return rv;
 }
@@ -1034,9 +1163,10 @@ static bool inside_cluster(graph_t *g, node_t *v) {
 static node_t *furthestnode(graph_t * g, node_t * v, int dir)
 {
     node_t *u, *rv;
+    graph_t *root = dot_root(g);
 
     rv = u = v;
-    while ((u = neighbor(u, dir))) {
+    while ((u = neighbor(root, u, dir))) {
 	if (is_a_normal_node_of(g, u))
 	    rv = u;
 	else if (is_a_vnode_of_an_edge_of(g, u))
@@ -1151,28 +1281,28 @@ fillRanks (Agraph_t* g)
     free (rnks);
 }
 
-static void init_mincross(graph_t * g)
+static void init_mincross(mincross_ctx_t *ctx, graph_t * g)
 {
     int size;
 
     if (Verbose)
 	start_timer();
 
-    ReMincross = false;
-    Root = g;
+    ctx->ReMincross = false;
+    ctx->Root = g;
     /* alloc +1 for the null terminator usage in do_ordering() */
     size = agnedges(dot_root(g)) + 1;
-    TE_list = gv_calloc(size, sizeof(edge_t*));
-    TI_list = gv_calloc(size, sizeof(int));
-    mincross_options(g);
+    ctx->TE_list = gv_calloc(size, sizeof(edge_t*));
+    ctx->TI_list = gv_calloc(size, sizeof(int));
+    mincross_options(ctx, g);
     if (GD_flags(g) & NEW_RANK)
 	fillRanks (g);
     class2(g);
     decompose(g, 1);
     allocate_ranks(g);
-    ordered_edges(g);
-    GlobalMinRank = GD_minrank(g);
-    GlobalMaxRank = GD_maxrank(g);
+    ordered_edges(ctx, g);
+    ctx->GlobalMinRank = GD_minrank(g);
+    ctx->GlobalMaxRank = GD_maxrank(g);
 }
 
 static void flat_rev(Agraph_t * g, Agedge_t * e)
@@ -1303,6 +1433,7 @@ void allocate_ranks(graph_t * g)
 void install_in_rank(graph_t * g, node_t * n)
 {
     int i, r;
+    graph_t *root = dot_root(g);
 
     r = ND_rank(n);
     i = GD_rank(g)[r].n;
@@ -1326,9 +1457,9 @@ void install_in_rank(graph_t * g, node_t * n)
 	assert(v != NULL);
     }
 #endif
-    if (ND_order(n) > GD_rank(Root)[r].an) {
+    if (ND_order(n) > GD_rank(root)[r].an) {
 	agerr(AGERR, "install_in_rank, line %d: ND_order(%s) [%d] > GD_rank(Root)[%d].an [%d]\n",
-	      __LINE__, agnameof(n), ND_order(n), r, GD_rank(Root)[r].an);
+	      __LINE__, agnameof(n), ND_order(n), r, GD_rank(root)[r].an);
 	return;
     }
     if (r < GD_minrank(g) || r > GD_maxrank(g)) {
@@ -1337,9 +1468,9 @@ void install_in_rank(graph_t * g, node_t * n)
 	return;
     }
     if (GD_rank(g)[r].v + ND_order(n) >
-	GD_rank(g)[r].av + GD_rank(Root)[r].an) {
+	GD_rank(g)[r].av + GD_rank(root)[r].an) {
 	agerr(AGERR, "install_in_rank, line %d: GD_rank(g)[%d].v + ND_order(%s) [%d] > GD_rank(g)[%d].av + GD_rank(Root)[%d].an [%d]\n",
-	      __LINE__, r, agnameof(n),ND_order(n), r, r, GD_rank(Root)[r].an);
+	      __LINE__, r, agnameof(n),ND_order(n), r, r, GD_rank(root)[r].an);
 	return;
     }
 }
@@ -1393,19 +1524,18 @@ void build_ranks(graph_t * g, int pass)
     }
     if (dequeue(q))
 	agerr(AGERR, "surprise\n");
+    graph_t *root = dot_root(g);
     for (i = GD_minrank(g); i <= GD_maxrank(g); i++) {
-	GD_rank(Root)[i].valid = false;
+	GD_rank(root)[i].valid = false;
 	if (GD_flip(g) && GD_rank(g)[i].n > 0) {
 	    node_t **vlist = GD_rank(g)[i].v;
 	    int num_nodes_1 = GD_rank(g)[i].n - 1;
 	    int half_num_nodes_1 = num_nodes_1 / 2;
 	    for (j = 0; j <= half_num_nodes_1; j++)
-		exchange(vlist[j], vlist[num_nodes_1 - j]);
+		exchange(root, vlist[j], vlist[num_nodes_1 - j]);
 	}
     }
 
-    if (g == dot_root(g) && ncross(g) > 0)
-	transpose(g, FALSE);
     free_queue(q);
 }
 
@@ -1463,7 +1593,7 @@ static int postorder(graph_t * g, node_t * v, node_t ** list, int r)
     return cnt;
 }
 
-static void flat_reorder(graph_t * g)
+static void flat_reorder(mincross_ctx_t *ctx, graph_t * g)
 {
     int i, r, pos, n_search, local_in_cnt, local_out_cnt, base_order;
     node_t *v, **left, **right, *t;
@@ -1540,12 +1670,13 @@ static void flat_reorder(graph_t * g)
 	    /* postprocess to restore intended order */
 	}
 	/* else do no harm! */
-	GD_rank(Root)[r].valid = false;
+	GD_rank(ctx->Root)[r].valid = false;
     }
     free(temprank);
 }
 
-static void reorder(graph_t * g, int r, bool reverse, bool hasfixed)
+static void reorder(mincross_ctx_t *ctx, graph_t * g, int r, bool reverse,
+                    bool hasfixed)
 {
     int changed = 0, nelt;
     node_t **vlist = GD_rank(g)[r].v;
@@ -1565,7 +1696,7 @@ static void reorder(graph_t * g, int r, bool reverse, bool hasfixed)
 	    for (rp = lp + 1; rp < ep; rp++) {
 		if (sawclust && ND_clust(*rp))
 		    continue;	/* ### */
-		if (left2right(g, *lp, *rp)) {
+		if (left2right(ctx, g, *lp, *rp)) {
 		    muststay = true;
 		    break;
 		}
@@ -1580,7 +1711,7 @@ static void reorder(graph_t * g, int r, bool reverse, bool hasfixed)
 		int p1 = ND_mval(*lp);
 		int p2 = ND_mval(*rp);
 		if (p1 > p2 || (p1 == p2 && reverse)) {
-		    exchange(*lp, *rp);
+		    exchange(ctx->Root, *lp, *rp);
 		    changed++;
 		}
 	    }
@@ -1591,13 +1722,13 @@ static void reorder(graph_t * g, int r, bool reverse, bool hasfixed)
     }
 
     if (changed) {
-	GD_rank(Root)[r].valid = false;
+	GD_rank(ctx->Root)[r].valid = false;
 	if (r > 0)
-	    GD_rank(Root)[r - 1].valid = false;
+	    GD_rank(ctx->Root)[r - 1].valid = false;
     }
 }
 
-static void mincross_step(graph_t * g, int pass)
+static void mincross_step(mincross_ctx_t *ctx, graph_t * g, int pass)
 {
     int r, other, first, last, dir;
 
@@ -1605,24 +1736,24 @@ static void mincross_step(graph_t * g, int pass)
 
     if (pass % 2 == 0) {	/* down pass */
 	first = GD_minrank(g) + 1;
-	if (GD_minrank(g) > GD_minrank(Root))
+	if (GD_minrank(g) > GD_minrank(ctx->Root))
 	    first--;
 	last = GD_maxrank(g);
 	dir = 1;
     } else {			/* up pass */
 	first = GD_maxrank(g) - 1;
 	last = GD_minrank(g);
-	if (GD_maxrank(g) < GD_maxrank(Root))
+	if (GD_maxrank(g) < GD_maxrank(ctx->Root))
 	    first++;
 	dir = -1;
     }
 
     for (r = first; r != last + dir; r += dir) {
 	other = r - dir;
-	bool hasfixed = medians(g, r, other);
-	reorder(g, r, reverse, hasfixed);
+	bool hasfixed = medians(ctx, g, r, other);
+	reorder(ctx, g, r, reverse, hasfixed);
     }
-    transpose(g, !reverse);
+    transpose(ctx, g, !reverse);
 }
 
 static int local_cross(elist l, int dir)
@@ -1647,30 +1778,50 @@ static int local_cross(elist l, int dir)
     return cross;
 }
 
+/* The accumulator tree used by rcross is a Fenwick tree over the positions
+ * 1..size of the lower rank, holding the weight of the edges ending there.
+ */
+static void acc_add(int *tree, int size, int pos, int weight)
+{
+    for (; pos <= size; pos += pos & -pos)
+	tree[pos] += weight;
+}
+
+/// total weight at positions 1..pos
+static int acc_sum(const int *tree, int pos)
+{
+    int sum = 0;
+    for (; pos > 0; pos -= pos & -pos)
+	sum += tree[pos];
+    return sum;
+}
+
+/* rcross:
+ * Weighted number of crossings between ranks r and r+1. Each edge is counted
+ * against the edges of nodes further left on rank r that end further right on
+ * rank r+1, which the accumulator tree yields in O(log n) per edge.
+ */
 static int rcross(graph_t * g, int r)
 {
-    int top, bot, cross, max, i, k;
+    int top, bot, cross, i;
     node_t **rtop, *v;
 
     cross = 0;
-    max = 0;
     rtop = GD_rank(g)[r].v;
 
-    int *Count = gv_calloc(GD_rank(Root)[r + 1].n + 1, sizeof(int));
+    const int size = GD_rank(g)[r + 1].n + 1;
+    int *tree = gv_calloc((size_t)size + 1, sizeof(int));
+    int total = 0;
 
     for (top = 0; top < GD_rank(g)[r].n; top++) {
 	edge_t *e;
-	if (max > 0) {
-	    for (i = 0; (e = ND_out(rtop[top]).list[i]); i++) {
-		for (k = ND_order(aghead(e)) + 1; k <= max; k++)
-		    cross += Count[k] * ED_xpenalty(e);
-	    }
+	for (i = 0; (e = ND_out(rtop[top]).list[i]); i++) {
+	    const int left = acc_sum(tree, ND_order(aghead(e)) + 1);
+	    cross += (total - left) * ED_xpenalty(e);
 	}
 	for (i = 0; (e = ND_out(rtop[top]).list[i]); i++) {
-	    int inv = ND_order(aghead(e));
-	    if (inv > max)
-		max = inv;
-	    Count[inv] += ED_xpenalty(e);
+	    acc_add(tree, size, ND_order(aghead(e)) + 1, ED_xpenalty(e));
+	    total += ED_xpenalty(e);
 	}
     }
     for (top = 0; top < GD_rank(g)[r].n; top++) {
@@ -1683,7 +1834,7 @@ static int rcross(graph_t * g, int r)
 	if (ND_has_port(v))
 	    cross += local_cross(ND_in(v), -1);
     }
-    free(Count);
+    free(tree);
     return cross;
 }
 
@@ -1691,7 +1842,7 @@ int ncross(graph_t * g)
 {
     int r, count, nc;
 
-    g = Root;
+    g = dot_root(g);
     count = 0;
     for (r = GD_minrank(g); r < GD_maxrank(g); r++) {
 	if (GD_rank(g)[r].valid)
@@ -1758,14 +1909,14 @@ static bool flat_mval(node_t * n)
 
 #define VAL(node,port) (MC_SCALE * ND_order(node) + (port).order)
 
-static bool medians(graph_t * g, int r0, int r1)
+static bool medians(mincross_ctx_t *ctx, graph_t * g, int r0, int r1)
 {
     int i, j0, lspan, rspan, *list;
     node_t *n, **v;
     edge_t *e;
     bool hasfixed = false;
 
-    list = TI_list;
+    list = ctx->TI_list;
     v = GD_rank(g)[r0].v;
     for (i = 0; i < GD_rank(g)[r0].n; i++) {
 	n = v[i];
@@ -1906,11 +2057,10 @@ void check_rs(graph_t * g, int null_ok)
     }
 }
 
-void check_order(void)
+void check_order(graph_t *g)
 {
     int i, r;
     node_t *v;
-    graph_t *g = Root;
 
     for (r = GD_minrank(g); r <= GD_maxrank(g); r++) {
 	assert(GD_rank(g)[r].v[GD_rank(g)[r].n] == NULL);
@@ -1922,21 +2072,23 @@ void check_order(void)
 }
 #endif
 
-static void mincross_options(graph_t * g)
+static void mincross_options(mincross_ctx_t *ctx, graph_t * g)
 {
     char *p;
     double f;
 
     /* set default values */
-    MinQuit = 8;
-    MaxIter = 24;
-    Convergence = .995;
+    ctx->MinQuit = 8;
+    ctx->MaxIter = 24;
+    ctx->Convergence = .995;
 
     p = agget(g, "mclimit");
     if (p && (f = atof(p)) > 0.0) {
-	MinQuit = MAX(1, MinQuit * f);
-	MaxIter = MAX(1, MaxIter * f);
+	ctx->MinQuit = MAX(1, ctx->MinQuit * f);
+	ctx->MaxIter = MAX(1, ctx->MaxIter * f);
     }
+
+    ctx->Incremental = dot_incremental(g);
 }
 
 #ifdef DEBUG
@@ -1968,12 +2120,12 @@ void check_vlists(graph_t * g)
 	for (i = 0; i < GD_rank(g)[r].n; i++) {
 	    u = GD_rank(g)[r].v[i];
 	    j = ND_order(u);
-	    assert(GD_rank(Root)[r].v[j] == u);
+	    assert(GD_rank(dot_root(g))[r].v[j] == u);
 	}
 	if (GD_rankleader(g)) {
 	    u = GD_rankleader(g)[r];
 	    j = ND_order(u);
-	    assert(GD_rank(Root)[r].v[j] == u);
+	    assert(GD_rank(dot_root(g))[r].v[j] == u);
 	}
     }
     for (c = 1; c <= GD_n_cluster(g); c++)
@@ -1984,7 +2136,7 @@ void node_in_root_vlist(node_t * n)
 {
     node_t **vptr;
 
-    for (vptr = GD_rank(Root)[ND_rank(n)].v; *vptr; vptr++)
+    for (vptr = GD_rank(dot_root(n))[ND_rank(n)].v; *vptr; vptr++)
 	if (*vptr == n)
 	    break;
     if (*vptr == 0)
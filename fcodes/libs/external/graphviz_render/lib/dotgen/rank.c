@@ -482,8 +482,13 @@ static void dot1_rank(graph_t * g, aspect_t* asp)
 
     if (asp)
 	rank3(g, asp);
-    else
+    else {
+	/* seed ranks from a previous layout; clusters are ranked separately
+	 * and keep their local ranks, so only flat graphs are seeded */
+	if (g == dot_root(g) && GD_n_cluster(g) == 0 && dot_incremental(g))
+	    dot_warm_ranks(g);
 	rank1(g);
+    }
 
     expand_ranksets(g, asp);
     cleanup1(g);
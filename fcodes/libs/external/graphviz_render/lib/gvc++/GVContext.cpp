@@ -1,17 +1,26 @@
+#include <mutex>
+
 #include "GVContext.h"
+#include "engine_lock.h"
 #include <gvc/gvc.h>
 
 namespace GVC {
 
-GVContext::GVContext(const lt_symlist_t *builtins, bool demand_loading)
-    : m_gvc(gvContextPlugins(builtins, demand_loading)) {}
+GVContext::GVContext(const lt_symlist_t *builtins, bool demand_loading) {
+  std::lock_guard<std::mutex> guard(engine_lock());
+  m_gvc = gvContextPlugins(builtins, demand_loading);
+}
 
-GVContext::GVContext() : m_gvc(gvContext()) {}
+GVContext::GVContext() {
+  std::lock_guard<std::mutex> guard(engine_lock());
+  m_gvc = gvContext();
+}
 
 GVContext::~GVContext() {
   if (!m_gvc) {
     return;
   }
+  std::lock_guard<std::mutex> guard(engine_lock());
   gvFreeContext(m_gvc);
 }
 
@@ -19,4 +28,17 @@ std::string_view GVContext::buildDate() const { return gvcBuildDate(m_gvc); }
 
 std::string_view GVContext::version() const { return gvcVersion(m_gvc); }
 
+void GVContext::setProfiling(bool enable) {
+  std::lock_guard<std::mutex> guard(engine_lock());
+  gvProfile(m_gvc, enable);
+}
+
+std::string GVContext::profile() {
+  std::lock_guard<std::mutex> guard(engine_lock());
+  char *json = gvProfileJSON(m_gvc);
+  std::string result{json};
+  gvFreeRenderData(json);
+  return result;
+}
+
 } // namespace GVC
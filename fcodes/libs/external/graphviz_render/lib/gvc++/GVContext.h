@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <string_view>
 #include <utility>
 
@@ -58,6 +59,18 @@ public:
   std::string_view buildDate() const;
   std::string_view version() const;
 
+  /**
+   * @brief setProfiling Enable or disable timing and counting the phases of
+   * the layouts and renders done with this context.
+   */
+  void setProfiling(bool enable);
+
+  /**
+   * @brief profile Return the profiles recorded since the last call, as a
+   * JSON array with an object per graph.
+   */
+  std::string profile();
+
 private:
   // the underlying C data structure
   GVC_t *m_gvc = nullptr;
@@ -1,11 +1,23 @@
 #include <cassert>
+#include <cerrno>
+#include <exception>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "GVContext.h"
 #include "GVLayout.h"
 #include "GVRenderData.h"
+#include "engine_lock.h"
 #include <cgraph++/AGraph.h>
 #include <gvc/gvc.h>
 
@@ -15,6 +27,7 @@ GVLayout::GVLayout(const std::shared_ptr<GVContext> &gvc,
                    const std::shared_ptr<CGraph::AGraph> &g,
                    const std::string &engine)
     : m_gvc(gvc), m_g(g) {
+  std::lock_guard<std::mutex> guard(engine_lock());
   if (gvLayoutDone(g->c_struct())) {
     gvFreeLayout(gvc->c_struct(), g->c_struct());
     throw std::runtime_error("Previous layout not yet destroyed");
@@ -45,10 +58,12 @@ GVLayout::~GVLayout() {
   if (!m_gvc || !m_g) {
     return;
   }
+  std::lock_guard<std::mutex> guard(engine_lock());
   gvFreeLayout(m_gvc->c_struct(), m_g->c_struct());
 }
 
 GVRenderData GVLayout::render(const std::string &format) const {
+  std::lock_guard<std::mutex> guard(engine_lock());
   char *result = nullptr;
   unsigned int length = 0;
   const auto rc = gvRenderData(m_gvc->c_struct(), m_g->c_struct(),
@@ -63,4 +78,72 @@ GVRenderData GVLayout::render(const std::string &format) const {
   return GVRenderData(result, length);
 }
 
+namespace {
+
+struct Sink {
+  std::vector<std::string> chunks;
+  std::exception_ptr error;
+};
+
+// keep a chunk for the writer, turning an exception into a refused chunk so
+// that it does not unwind through C code
+size_t sink(void *context, const char *data, size_t length) {
+  auto &s = *static_cast<Sink *>(context);
+  try {
+    s.chunks.emplace_back(data, length);
+  } catch (...) {
+    s.error = std::current_exception();
+    return 0;
+  }
+  return length;
+}
+
+} // namespace
+
+void GVLayout::render(
+    const std::string &format,
+    const std::function<void(std::string_view)> &writer) const {
+  // The output is collected under the engine lock and only then passed to
+  // writer, so that a slow writer does not hold up other threads and a writer
+  // may itself call into gvc++.
+  Sink s;
+  int rc;
+  {
+    std::lock_guard<std::mutex> guard(engine_lock());
+    rc = gvRenderSink(m_gvc->c_struct(), m_g->c_struct(), format.c_str(), sink,
+                      &s);
+  }
+  if (s.error) {
+    std::rethrow_exception(s.error);
+  }
+  if (rc) {
+    throw std::runtime_error("Rendering failed");
+  }
+  for (auto &chunk : s.chunks) {
+    writer(chunk);
+    // release each chunk once written
+    std::string().swap(chunk);
+  }
+}
+
+void GVLayout::render(const std::string &format, int fd) const {
+  render(format, [fd](std::string_view chunk) {
+    while (!chunk.empty()) {
+#ifdef _WIN32
+      const auto n = _write(fd, chunk.data(), static_cast<unsigned>(chunk.size()));
+#else
+      const auto n = write(fd, chunk.data(), chunk.size());
+#endif
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::system_error(errno, std::generic_category(),
+                                "writing rendered output");
+      }
+      chunk.remove_prefix(static_cast<std::size_t>(n));
+    }
+  });
+}
+
 } // namespace GVC
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <string_view>
 
 #include "AGraph.h"
 #include "GVContext.h"
@@ -22,6 +24,13 @@ namespace GVC {
 
 /**
  * @brief The GVLayout class represents a graph layout
+ *
+ * Layouts of different graphs may be created, rendered and destroyed from
+ * different threads, provided each thread uses its own GVContext. This is
+ * safe but not parallel: every layout, render and release takes one
+ * process-wide lock, because the engines still share library-wide state (see
+ * engine_lock.h). Constructing a CGraph::AGraph from DOT source is not covered
+ * by this and should be done from one thread at a time.
  */
 
 class GVLAYOUT_API GVLayout {
@@ -46,6 +55,19 @@ public:
   // render the layout in the specified format
   GVRenderData render(const std::string &format) const;
 
+  // render the layout in the specified format, passing the output to writer in
+  // chunks of up to 64 KiB. The chunks are produced under the process-wide
+  // lock and passed to writer once rendering is done and the lock released,
+  // so the whole document is held in memory, but not in one buffer, and
+  // writer may be slow or call into gvc++ itself. An exception thrown by
+  // writer stops the output and is rethrown.
+  void render(const std::string &format,
+              const std::function<void(std::string_view)> &writer) const;
+
+  // render the layout in the specified format, writing the output to a file
+  // descriptor in chunks, as above
+  void render(const std::string &format, int fd) const;
+
 private:
   std::shared_ptr<GVContext> m_gvc;
   std::shared_ptr<CGraph::AGraph> m_g;
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <mutex>
+
+namespace GVC {
+
+/// lock serializing calls into the Graphviz layout and rendering engines
+///
+/// Per-run algorithm state (network simplex, crossing minimization,
+/// postprocessing, output compression) is kept in per-call or per-job
+/// structures. But the engines still share library-wide state, even between
+/// contexts:
+///
+///   - the attribute symbols (`N_width`, `E_weight`, ...) and settings
+///     (`State`, `Ndim`, `EdgeLabelsDone`, ...) of common/globals.h, which
+///     each layout rebinds to its own graph
+///   - the working buffers of spline routing (common/routespl.c) and of the
+///     shortest path and spline fitting in lib/pathplan
+///   - the string dictionary of emit.c and the color scheme of colxlate.c
+///   - the error reporting state of cgraph (`agerr`, `agerrors`)
+///
+/// Every call of the C++ API into a context, a layout or a render takes this
+/// lock, so layouts and renders of different graphs run one after another,
+/// never in parallel. Parsing DOT, as done by `CGraph::AGraph`, uses the
+/// global state of the cgraph parser and does not take this lock.
+///
+/// The lock can only be narrowed once all of the state above belongs to a
+/// context or a job. Until then, gvc++ offers thread safety, not throughput.
+inline std::mutex &engine_lock() {
+  static std::mutex lock;
+  return lock;
+}
+
+} // namespace GVC
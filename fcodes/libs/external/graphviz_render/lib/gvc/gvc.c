@@ -10,14 +10,18 @@
 
 #include "config.h"
 
+#include <cgraph/alloc.h>
 #include <gvc/gvc.h>
 #include <common/const.h>
+#include <common/profile.h>
+#include <common/render.h>
 #include <gvc/gvcjob.h>
 #include <gvc/gvcint.h>
 #include <gvc/gvcproc.h>
 #include <gvc/gvconfig.h>
 #include <gvc/gvio.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 GVC_t *gvContext(void)
@@ -215,6 +219,49 @@ int gvRenderData(GVC_t *gvc, graph_t *g, const char *format, char **result, unsi
     return rc;
 }
 
+/* size of the chunks passed to the sink of gvRenderSink */
+#define RENDER_SINK_CHUNK (64 * 1024)
+
+/* Render layout in a specified format to a sink, chunk by chunk */
+int gvRenderSink(GVC_t *gvc, graph_t *g, const char *format,
+                 gvrender_sink_t sink, void *context)
+{
+    int rc;
+    GVJ_t *job;
+
+    /* create a job for the required format */
+    bool r = gvjobs_output_langname(gvc, format);
+    job = gvc->job;
+    if (!r) {
+	agerr(AGERR, "Format: \"%s\" not recognized. Use one of:%s\n",
+                format, gvplugin_list(gvc, API_device, format));
+	return -1;
+    }
+
+    job->output_lang = gvrender_select(job, job->output_langname);
+    if (!LAYOUT_DONE(g) && !(job->flags & LAYOUT_NOT_REQUIRED)) {
+	agerrorf( "Layout was not done\n");
+	return -1;
+    }
+
+    job->sink = sink;
+    job->sink_context = context;
+    job->sink_data = gv_alloc(RENDER_SINK_CHUNK);
+    job->sink_data_allocated = RENDER_SINK_CHUNK;
+    job->sink_data_position = 0;
+    job->sink_failed = false;
+
+    rc = gvRenderJobs(gvc, g);
+    gvrender_end_job(job);
+
+    if (rc == 0 && job->sink_failed)
+	rc = -1;
+    free(job->sink_data);
+    gvjobs_delete(gvc);
+
+    return rc;
+}
+
 /* gvFreeRenderData:
  * Utility routine to free memory allocated in gvRenderData, as the application code may use
  * a different runtime library.
@@ -229,6 +276,26 @@ void gvAddLibrary(GVC_t *gvc, gvplugin_library_t *lib)
     gvconfig_plugin_install_from_library(gvc, NULL, lib);
 }
 
+void gvTextCache(GVC_t *gvc, bool enable)
+{
+    textspan_cache_enable(gvc, enable);
+}
+
+void gvTextCacheStats(GVC_t *gvc, size_t *hits, size_t *misses)
+{
+    textspan_cache_stats(gvc, hits, misses);
+}
+
+void gvProfile(GVC_t *gvc, bool enable)
+{
+    gv_profile_enable(gvc, enable, NULL);
+}
+
+char *gvProfileJSON(GVC_t *gvc)
+{
+    return gv_profile_json(gvc);
+}
+
 char **gvcInfo(GVC_t* gvc) { return gvc->common.info; }
 char *gvcVersion(GVC_t* gvc) { return gvc->common.info[1]; }
 char *gvcBuildDate(GVC_t* gvc) { return gvc->common.info[2]; }
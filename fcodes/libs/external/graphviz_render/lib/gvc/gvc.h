@@ -24,6 +24,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "types.h"
 #include "gvplugin.h"
@@ -99,6 +100,23 @@ GVC_API int gvRenderData(GVC_t *gvc, graph_t *g, const char *format, char **resu
 /* Free memory allocated and pointed to by *result in gvRenderData */
 GVC_API void gvFreeRenderData (char* data);
 
+/** Render layout in a specified format, streaming the output to a callback
+ *
+ * The output is passed to sink in chunks of up to 64 KiB while it is
+ * produced, compressed formats included, so the whole document is never held
+ * in memory. Larger pieces of output, such as embedded images, may be passed
+ * on as one chunk without being copied. If sink refuses a chunk, it is not
+ * called again and the remaining output is discarded.
+ * @param gvc Graphviz context of the layout
+ * @param g Graph to render
+ * @param format Output format, as for gvRender
+ * @param sink Receiver of the output
+ * @param context Passed to every call of sink
+ * @return 0 on success, non-zero if rendering failed or sink refused output
+ */
+GVC_API int gvRenderSink(GVC_t *gvc, graph_t *g, const char *format,
+                         gvrender_sink_t sink, void *context);
+
 /* Render layout according to -T and -o options found by gvParseArgs */
 GVC_API int gvRenderJobs(GVC_t *gvc, graph_t *g);
 
@@ -125,6 +143,54 @@ GVC_API char **gvPluginList(GVC_t *gvc, const char *kind, int *sz);
  */
 GVC_API void gvAddLibrary(GVC_t *gvc, gvplugin_library_t *lib);
 
+/** Enable or disable the cache of text sizes of a context
+ *
+ * Sizes of label text measured by the text layout plugin are remembered and
+ * reused for identical text in the same font, by all graphs laid out with the
+ * context. The cache is enabled by default. Disabling it drops its contents.
+ *
+ * Only sizes are cached, not the layouts some renderers draw text from, so the
+ * cache stops being consulted once the context selects such a renderer, e.g.
+ * cairo or LASi. Text measured before that, when a graph is laid out before
+ * its output format is known, is given a layout when it is drawn. The cache is
+ * locked, so a context's text can be measured from several threads.
+ * @param gvc Graphviz context owning the cache
+ * @param enable Whether text sizes should be cached
+ */
+GVC_API void gvTextCache(GVC_t *gvc, bool enable);
+
+/** Statistics of the text size cache of a context
+ * @param gvc Graphviz context owning the cache
+ * @param hits [out] Number of text sizes taken from the cache
+ * @param misses [out] Number of text sizes measured and added to the cache
+ */
+GVC_API void gvTextCacheStats(GVC_t *gvc, size_t *hits, size_t *misses);
+
+/** Enable or disable profiling of the layouts and renders of a context
+ *
+ * When enabled, the time spent in each phase of laying out and rendering a
+ * graph, such as ranking, crossing minimization and spline routing in dot,
+ * is measured together with counters of the work done, like network simplex
+ * iterations and edge crossings. The profile of a graph covers its layout
+ * and the render that follows it. Profiles are kept until retrieved with
+ * gvProfileJSON. A graph with the attribute `profile=true` is profiled even
+ * when profiling is disabled, its profile being written to stderr.
+ * @param gvc Graphviz context to profile
+ * @param enable Whether layouts and renders should be profiled
+ */
+GVC_API void gvProfile(GVC_t *gvc, bool enable);
+
+/** Profiles of a context, as JSON
+ *
+ * The result is an array with an object per profiled graph, giving the graph
+ * name, the layout engine, the tree of timed phases (`spans`, each with
+ * `name`, `calls`, `seconds` and `children`) and the `counters`. Profiles are
+ * removed from the context once returned.
+ * @param gvc Graphviz context that was profiled
+ * @return JSON text, to be freed with gvFreeRenderData
+ */
+GVC_API char *gvProfileJSON(GVC_t *gvc);
+
 /** Perform a Transitive Reduction on a graph
  * @param g  graph to be transformed.
  */
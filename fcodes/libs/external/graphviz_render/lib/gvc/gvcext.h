@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -43,6 +45,15 @@ extern "C" {
 
     typedef struct gvplugin_available_s gvplugin_available_t;
 
+    /// receiver of rendered output, see gvRenderSink
+    ///
+    /// @param context The context given to gvRenderSink
+    /// @param data Next chunk of output, valid only for the duration of the call
+    /// @param length Number of bytes in data, never 0
+    /// @return length if the chunk was taken; anything else stops the output
+    typedef size_t (*gvrender_sink_t)(void *context, const char *data,
+                                      size_t length);
+
 #if !defined(LTDL_H)
 extern lt_symlist_t lt_preloaded_symbols[];
 #endif
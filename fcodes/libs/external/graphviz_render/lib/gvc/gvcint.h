@@ -105,6 +105,10 @@ extern "C" {
 	Dtdisc_t textfont_disc;
 	Dt_t *textfont_dt;
 	gvplugin_active_textlayout_t textlayout; /* always use best avail for all jobs */
+	struct textspan_cache_s *textspan_cache; /* sizes of measured text spans */
+
+	/* timings and counters of layouts and renders */
+	struct gvprofile_s *profile;
 //	void (*free_layout) (void *layout);   /* function for freeing layouts (mostly used by pango) */
 	
 /* FIXME - everything below should probably move to GVG_t */
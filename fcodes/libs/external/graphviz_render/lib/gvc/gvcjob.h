@@ -76,6 +76,7 @@ extern "C" {
  GVRENDER_NO_WHITE_BG		don't paint white background, assumes white paper -Tps 
  LAYOUT_NOT_REQUIRED 		don't perform layout -Tcanon 		
  OUTPUT_NOT_REQUIRED		don't use gvdevice for output (basically when agwrite() used instead) -Tcanon, -Txdot 
+ GVRENDER_DRAWS_TEXT_LAYOUT	draws text from the layout the text layout plugin made for it -Tpng:cairo, -Tps:lasi 
  */
 
 
@@ -106,6 +107,7 @@ extern "C" {
 #define GVRENDER_NO_WHITE_BG (1<<25)
 #define LAYOUT_NOT_REQUIRED (1<<26)
 #define OUTPUT_NOT_REQUIRED (1<<27)
+#define GVRENDER_DRAWS_TEXT_LAYOUT (1<<28)
 
     typedef struct {
 	int flags;
@@ -284,6 +286,13 @@ extern "C" {
 	char *output_data;
 	unsigned int output_data_allocated;
 	unsigned int output_data_position;
+	struct gvdevice_zstate_s *zstate; /* deflate state for compressed output, private to gvdevice.c */
+	gvrender_sink_t sink;	/* receiver of output chunks, see gvRenderSink() */
+	void *sink_context;
+	char *sink_data;	/* output not yet passed to the sink */
+	size_t sink_data_allocated;
+	size_t sink_data_position;
+	bool sink_failed;	/* the sink refused output, the rest is dropped */
 
 	const char *output_langname;
 	int output_lang;
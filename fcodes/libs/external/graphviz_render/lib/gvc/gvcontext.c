@@ -22,6 +22,7 @@
 
 #include "builddate.h"
 #include <cgraph/alloc.h>
+#include <common/profile.h>
 #include <common/render.h>
 #include <common/types.h>
 #include <gvc/gvplugin.h>
@@ -84,6 +85,7 @@ int gvFreeContext(GVC_t * gvc)
     free(gvc->config_path);
     free(gvc->input_filenames);
     textfont_dict_close(gvc);
+    gv_profile_free(gvc);
     for (size_t i = 0; i < sizeof(gvc->apis) / sizeof(gvc->apis[0]); ++i) {
 	for (api = gvc->apis[i]; api != NULL; api = api_next) {
 	    api_next = api->next;
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <errno.h>
 #include <unistd.h>
 
@@ -38,14 +39,18 @@
 static const unsigned char z_file_header[] =
    {0x1f, 0x8b, /*magic*/ Z_DEFLATED, 0 /*flags*/, 0,0,0,0 /*time*/, 0 /*xflags*/, OS_CODE};
 
-static z_stream z_strm;
-static unsigned char *df;
-static unsigned int dfallocated;
-static uint64_t crc;
+/// deflate state of a job writing compressed output
+struct gvdevice_zstate_s {
+  z_stream z_strm;
+  unsigned char *df;
+  unsigned int dfallocated;
+  uint64_t crc;
+};
 #endif /* HAVE_LIBZ */
 
 #include <assert.h>
 #include <cgraph/agxbuf.h>
+#include <cgraph/alloc.h>
 #include <cgraph/exit.h>
 #include <common/const.h>
 #include <common/memory.h>
@@ -58,19 +63,101 @@ static uint64_t crc;
 
 static const int PAGE_ALIGN = 4095;		/* align to a 4K boundary (less one), typical for Linux, Mac OS X and Windows memory allocation */
 
+/* sink_write:
+ * Pass output to the sink of a job. Once the sink has refused output,
+ * everything after it is dropped, so the render can run to its end.
+ */
+static void sink_write(GVJ_t * job, const char *s, size_t len)
+{
+    if (!job->sink_failed && job->sink(job->sink_context, s, len) != len)
+	job->sink_failed = true;
+}
+
+static void sink_flush(GVJ_t * job)
+{
+    if (job->sink_data_position > 0) {
+	sink_write(job, job->sink_data, job->sink_data_position);
+	job->sink_data_position = 0;
+    }
+}
+
+/* output_data_reserve:
+ * Grow the result of gvRenderData to hold len more bytes and a null
+ * terminator. Growth is geometric, so large renders are not copied over and
+ * over.
+ */
+static void output_data_reserve(GVJ_t * job, size_t len)
+{
+    size_t need = (size_t)job->output_data_position + len + 1;
+    if (need <= job->output_data_allocated)
+	return;
+    if (need < 2 * (size_t)job->output_data_allocated)
+	need = 2 * (size_t)job->output_data_allocated;
+    need = (need + PAGE_ALIGN) & ~(size_t)PAGE_ALIGN;
+    if (need > UINT_MAX) {
+	job->common->errorfn("output too large\n");
+	graphviz_exit(1);
+    }
+    job->output_data_allocated = (unsigned)need;
+    job->output_data = realloc(job->output_data, job->output_data_allocated);
+    if (!job->output_data) {
+	job->common->errorfn("memory allocation failure\n");
+	graphviz_exit(1);
+    }
+}
+
+/* output_room:
+ * Where uncompressed output of at least want bytes can be formatted in place,
+ * at the end of the sink buffer or of the result of gvRenderData. The space
+ * available, which includes room for a null terminator, is returned in room.
+ * Text formatted there is committed with output_commit. Returns NULL if the
+ * output of the job does not go to such a buffer.
+ */
+static char *output_room(GVJ_t * job, size_t want, size_t *room)
+{
+    if (job->flags & GVDEVICE_COMPRESSED_FORMAT)
+	return NULL;
+    if (job->sink) {
+	if (job->sink_data_allocated - job->sink_data_position < want)
+	    sink_flush(job);
+	*room = job->sink_data_allocated - job->sink_data_position;
+	return *room >= want ? job->sink_data + job->sink_data_position : NULL;
+    }
+    if (job->gvc->write_fn || !job->output_data)
+	return NULL;
+    output_data_reserve(job, want);
+    *room = job->output_data_allocated - job->output_data_position;
+    return job->output_data + job->output_data_position;
+}
+
+static void output_commit(GVJ_t * job, size_t len)
+{
+    if (job->sink) {
+	job->sink_data_position += len;
+    } else {
+	job->output_data_position += len;
+	job->output_data[job->output_data_position] = '\0'; /* keep null terminated */
+    }
+}
+
 static size_t gvwrite_no_z(GVJ_t * job, const void *s, size_t len) {
+    if (job->sink) {
+	if (len > job->sink_data_allocated - job->sink_data_position) {
+	    sink_flush(job);
+	    /* output that would not fit a chunk is passed on without copying */
+	    if (len >= job->sink_data_allocated) {
+		sink_write(job, s, len);
+		return len;
+	    }
+	}
+	memcpy(job->sink_data + job->sink_data_position, s, len);
+	job->sink_data_position += len;
+	return len;
+    }
     if (job->gvc->write_fn)   /* externally provided write discipline */
 	return job->gvc->write_fn(job, s, len);
     if (job->output_data) {
-	if (len > job->output_data_allocated - (job->output_data_position + 1)) {
-	    /* ensure enough allocation for string = null terminator */
-	    job->output_data_allocated = (job->output_data_position + len + 1 + PAGE_ALIGN) & ~PAGE_ALIGN;
-	    job->output_data = realloc(job->output_data, job->output_data_allocated);
-	    if (!job->output_data) {
-                job->common->errorfn("memory allocation failure\n");
-		graphviz_exit(1);
-	    }
-	}
+	output_data_reserve(job, len);
 	memcpy(job->output_data + job->output_data_position, s, len);
         job->output_data_position += len;
 	job->output_data[job->output_data_position] = '\0'; /* keep null terminated */
@@ -121,7 +208,7 @@ int gvdevice_initialize(GVJ_t * job)
     if (gvde && gvde->initialize) {
 	gvde->initialize(job);
     }
-    else if (job->output_data) {
+    else if (job->output_data || job->sink) {
     }
     /* if the device has no initialization then it uses file output */
     else if (!job->output_file) {        /* if not yet opened */
@@ -153,7 +240,8 @@ int gvdevice_initialize(GVJ_t * job)
 
     if (job->flags & GVDEVICE_COMPRESSED_FORMAT) {
 #ifdef HAVE_LIBZ
-	z_stream *z = &z_strm;
+	job->zstate = gv_alloc(sizeof(*job->zstate));
+	z_stream *z = &job->zstate->z_strm;
 
 	z->zalloc = 0;
 	z->zfree = 0;
@@ -162,10 +250,12 @@ int gvdevice_initialize(GVJ_t * job)
 	z->next_out = NULL;
 	z->avail_in = 0;
 
-	crc = crc32(0L, Z_NULL, 0);
+	job->zstate->crc = crc32(0L, Z_NULL, 0);
 
 	if (deflateInit2(z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
 	    job->common->errorfn("Error initializing for deflation\n");
+	    free(job->zstate);
+	    job->zstate = NULL;
 	    return 1;
 	}
 	gvwrite_no_z(job, z_file_header, sizeof(z_file_header));
@@ -177,51 +267,87 @@ int gvdevice_initialize(GVJ_t * job)
     return 0;
 }
 
+#ifdef HAVE_LIBZ
+/* deflate_window:
+ * Point deflate at where its output should go: straight into the sink buffer
+ * of the job, or else into the job's deflate buffer.
+ */
+static void deflate_window(GVJ_t * job)
+{
+    struct gvdevice_zstate_s *zs = job->zstate;
+    z_streamp z = &zs->z_strm;
+
+    if (job->sink) {
+	if (job->sink_data_position == job->sink_data_allocated)
+	    sink_flush(job);
+	z->next_out = (unsigned char*)job->sink_data + job->sink_data_position;
+	z->avail_out = job->sink_data_allocated - job->sink_data_position;
+    } else {
+	z->next_out = zs->df;
+	z->avail_out = zs->dfallocated;
+    }
+}
+
+/* deflate_emit:
+ * Pass on what deflate wrote since deflate_window.
+ */
+static void deflate_emit(GVJ_t * job)
+{
+    struct gvdevice_zstate_s *zs = job->zstate;
+    z_streamp z = &zs->z_strm;
+
+    if (job->sink) {
+	job->sink_data_position = (size_t)((char*)z->next_out - job->sink_data);
+	return;
+    }
+    size_t olen = (size_t)(z->next_out - zs->df);
+    if (olen) {
+	size_t ret = gvwrite_no_z(job, zs->df, olen);
+	if (ret != olen) {
+	    job->common->errorfn("gvwrite_no_z problem %d\n", ret);
+	    graphviz_exit(1);
+	}
+    }
+}
+#endif
+
 size_t gvwrite (GVJ_t * job, const char *s, size_t len)
 {
-    size_t ret, olen;
+    size_t ret;
 
     if (!len || !s)
 	return 0;
 
     if (job->flags & GVDEVICE_COMPRESSED_FORMAT) {
 #ifdef HAVE_LIBZ
-	z_streamp z = &z_strm;
+	struct gvdevice_zstate_s *zs = job->zstate;
+	z_streamp z = &zs->z_strm;
 
 	size_t dflen = deflateBound(z, len);
-	if (dfallocated < dflen) {
-	    dfallocated = (dflen + 1 + PAGE_ALIGN) & ~PAGE_ALIGN;
-	    df = realloc(df, dfallocated);
-	    if (! df) {
+	if (!job->sink && zs->dfallocated < dflen) {
+	    zs->dfallocated = (dflen + 1 + PAGE_ALIGN) & ~PAGE_ALIGN;
+	    zs->df = realloc(zs->df, zs->dfallocated);
+	    if (! zs->df) {
                 job->common->errorfn("memory allocation failure\n");
 		graphviz_exit(1);
 	    }
 	}
 
-	crc = crc32(crc, (const unsigned char*)s, len);
+	zs->crc = crc32(zs->crc, (const unsigned char*)s, len);
 
 	z->next_in = (unsigned char*)s;
 	z->avail_in = len;
 	while (z->avail_in) {
-	    z->next_out = df;
-	    z->avail_out = dfallocated;
+	    deflate_window(job);
 	    int r = deflate(z, Z_NO_FLUSH);
 	    if (r != Z_OK) {
                 job->common->errorfn("deflation problem %d\n", r);
 	        graphviz_exit(1);
 	    }
-
-	    if ((olen = z->next_out - df)) {
-		ret = gvwrite_no_z(job, df, olen);
-	        if (ret != olen) {
-                    job->common->errorfn("gvwrite_no_z problem %d\n", ret);
-	            graphviz_exit(1);
-	        }
-	    }
+	    deflate_emit(job);
 	}
 
 #else
-        (void)olen;
 	job->common->errorfn("No libz support.\n");
 	graphviz_exit(1);
 #endif
@@ -240,7 +366,7 @@ int gvferror (FILE* stream)
 {
     GVJ_t *job = (GVJ_t*)stream;
 
-    if (!job->gvc->write_fn && !job->output_data)
+    if (!job->sink && !job->gvc->write_fn && !job->output_data)
 	return ferror(job->output_file);
 
     return 0;
@@ -285,6 +411,10 @@ int gvputc(GVJ_t * job, int c)
 
 int gvflush (GVJ_t * job)
 {
+    if (job->sink) {
+	sink_flush(job);
+	return job->sink_failed ? EOF : 0;
+    }
     if (job->output_file
       && ! job->external_context
       && ! job->gvc->write_fn) {
@@ -323,40 +453,43 @@ void gvdevice_finalize(GVJ_t * job)
 
     if (job->flags & GVDEVICE_COMPRESSED_FORMAT) {
 #ifdef HAVE_LIBZ
-	z_streamp z = &z_strm;
+	struct gvdevice_zstate_s *zs = job->zstate;
+	z_streamp z = &zs->z_strm;
 	unsigned char out[8] = "";
 	int ret;
 	int cnt = 0;
 
 	z->next_in = out;
 	z->avail_in = 0;
-	z->next_out = df;
-	z->avail_out = dfallocated;
+	deflate_window(job);
 	while ((ret = deflate (z, Z_FINISH)) == Z_OK && (cnt++ <= 100)) {
-	    gvwrite_no_z(job, df, z->next_out - df);
-	    z->next_out = df;
-	    z->avail_out = dfallocated;
+	    deflate_emit(job);
+	    deflate_window(job);
 	}
 	if (ret != Z_STREAM_END) {
             job->common->errorfn("deflation finish problem %d cnt=%d\n", ret, cnt);
 	    graphviz_exit(1);
 	}
-	gvwrite_no_z(job, df, z->next_out - df);
+	deflate_emit(job);
 
 	ret = deflateEnd(z);
 	if (ret != Z_OK) {
 	    job->common->errorfn("deflation end problem %d\n", ret);
 	    graphviz_exit(1);
 	}
-	out[0] = (unsigned char)crc;
-	out[1] = (unsigned char)(crc >> 8);
-	out[2] = (unsigned char)(crc >> 16);
-	out[3] = (unsigned char)(crc >> 24);
+	out[0] = (unsigned char)zs->crc;
+	out[1] = (unsigned char)(zs->crc >> 8);
+	out[2] = (unsigned char)(zs->crc >> 16);
+	out[3] = (unsigned char)(zs->crc >> 24);
 	out[4] = (unsigned char)z->total_in;
 	out[5] = (unsigned char)(z->total_in >> 8);
 	out[6] = (unsigned char)(z->total_in >> 16);
 	out[7] = (unsigned char)(z->total_in >> 24);
 	gvwrite_no_z(job, out, sizeof(out));
+
+	free(zs->df);
+	free(zs);
+	job->zstate = NULL;
 #else
 	job->common->errorfn("No libz support\n");
 	graphviz_exit(1);
@@ -375,6 +508,8 @@ void gvdevice_finalize(GVJ_t * job)
 	gvflush (job);
 	gvdevice_close(job);
     }
+    else if (job->sink)
+	sink_flush(job);
 }
 
 void gvprintf(GVJ_t * job, const char *format, ...)
@@ -385,6 +520,22 @@ void gvprintf(GVJ_t * job, const char *format, ...)
     char* bp = buf;
 
     va_start(argp, format);
+    {
+	/* format straight into the output buffer, if there is one */
+	size_t room;
+	char *out = output_room(job, BUFSIZ, &room);
+	if (out) {
+	    va_list argp2;
+	    va_copy(argp2, argp);
+	    len = vsnprintf(out, room, format, argp2);
+	    va_end(argp2);
+	    if (len >= 0 && (size_t)len < room) {
+		output_commit(job, (size_t)len);
+		va_end(argp);
+		return;
+	    }
+	}
+    }
     {
 	va_list argp2;
 	va_copy(argp2, argp);
@@ -425,11 +576,15 @@ val_str(maxnegnum, -999999999999999.99)
 /* we use len and don't need the string to be terminated */
 /* #define TERMINATED_NUMBER_STRING */
 
-/* Note.  Returned string is only good until the next call to gvprintnum */
-static char * gvprintnum (size_t *len, double number)
+/// buffer big enough for the worst case of gvprintnum
+typedef struct {
+  char data[sizeof(maxnegnumstr)];
+} gvprintnum_buf_t;
+
+/* Note.  Returned string points into tmpbuf, or is a static constant */
+static char * gvprintnum (gvprintnum_buf_t *tmpbuf, size_t *len, double number)
 {
-    static char tmpbuf[sizeof(maxnegnumstr)];   /* buffer big enough for worst case */
-    char *result = tmpbuf+sizeof(maxnegnumstr); /* init result to end of tmpbuf */
+    char *result = tmpbuf->data + sizeof(maxnegnumstr); /* init result to end of tmpbuf */
     long int N;
     bool showzeros, negative;
     int digit, i;
@@ -483,9 +638,9 @@ static char * gvprintnum (size_t *len, double number)
     if (negative)			/* print "-" if needed */
         *--result = '-';
 #ifdef TERMINATED_NUMBER_STRING
-    *len = tmpbuf+sizeof(maxnegnumstr)-1 - result;
+    *len = tmpbuf->data + sizeof(maxnegnumstr) - 1 - result;
 #else
-    *len = tmpbuf+sizeof(maxnegnumstr) - result;
+    *len = tmpbuf->data + sizeof(maxnegnumstr) - result;
 #endif
     return result;				
 }
@@ -494,6 +649,7 @@ static char * gvprintnum (size_t *len, double number)
 #ifdef GVPRINTNUM_TEST
 int main (int argc, char *argv[])
 {
+    gvprintnum_buf_t tmpbuf;
     char *buf;
     size_t len;
 
@@ -509,7 +665,7 @@ int main (int argc, char *argv[])
     int i = sizeof(test) / sizeof(test[0]);
 
     while (i--) {
-	buf = gvprintnum(&len, test[i]);
+	buf = gvprintnum(&tmpbuf, &len, test[i]);
         fprintf (stdout, "%g = %s %d\n", test[i], buf, len);
     }
 
@@ -517,8 +673,33 @@ int main (int argc, char *argv[])
 }
 #endif
 
+/// length of a number printed with a fixed number of decimals, less the zeros
+/// after its decimal point that carry no information
+static size_t trim_zeros(const char *s, size_t len)
+{
+    const char *period = memchr(s, '.', len);
+    if (period == NULL)
+	return len;
+    while (s[len - 1] == '0')
+	--len;
+    if (s + len - 1 == period)
+	--len;
+    return len;
+}
+
 void gvprintdouble(GVJ_t * job, double num)
 {
+    /* format straight into the output buffer, if there is one */
+    size_t room;
+    char *out = output_room(job, 64, &room);
+    if (out) {
+	int len = snprintf(out, room, "%.02f", num);
+	if (len >= 0 && (size_t)len < room) {
+	    output_commit(job, trim_zeros(out, (size_t)len));
+	    return;
+	}
+    }
+
     agxbuf buf = {0};
 
     agxbprint(&buf, "%.02f", num);
@@ -530,13 +711,14 @@ void gvprintdouble(GVJ_t * job, double num)
 
 void gvprintpointf(GVJ_t * job, pointf p)
 {
+    gvprintnum_buf_t tmpbuf;
     char *buf;
     size_t len;
 
-    buf = gvprintnum(&len, p.x);
+    buf = gvprintnum(&tmpbuf, &len, p.x);
     gvwrite(job, buf, len);
     gvwrite(job, " ", 1);
-    buf = gvprintnum(&len, p.y);
+    buf = gvprintnum(&tmpbuf, &len, p.y);
     gvwrite(job, buf, len);
 } 
 
@@ -12,8 +12,10 @@
 
 #include	<cgraph/alloc.h>
 #include	<common/memory.h>
+#include	<common/render.h>
 #include	<common/types.h>
 #include        <gvc/gvplugin.h>
+#include        <gvc/gvplugin_render.h>
 #include        <gvc/gvcjob.h>
 #include        <gvc/gvcint.h>
 #include        <gvc/gvcproc.h>
@@ -78,8 +80,16 @@ bool gvjobs_output_langname(GVC_t * gvc, const char *name)
     output_langname_job->gvc = gvc;
 
     /* load it now to check that it exists */
-    if (gvplugin_load(gvc, API_device, name))
+    if (gvplugin_load(gvc, API_device, name)) {
+	/* the device loaded the renderer it depends on, which the text span
+	 * cache must know of before any layout */
+	gvplugin_available_t *render = gvc->api[API_render];
+	if (render) {
+	    gvrender_features_t *features = render->typeptr->features;
+	    textspan_cache_renderer(gvc, features->flags);
+	}
 	return true;
+    }
     return false;
 }
 
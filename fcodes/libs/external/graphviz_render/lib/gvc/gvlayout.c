@@ -16,6 +16,7 @@
 #include "config.h"
 
 #include <common/const.h>
+#include <common/profile.h>
 #include <gvc/gvplugin_layout.h>
 #include <gvc/gvcint.h>
 #include <cgraph/cgraph.h>
@@ -77,8 +78,12 @@ int gvLayoutJobs(GVC_t * gvc, Agraph_t * g)
     if (! gvle)
 	return -1;
 
+    const bool profiled = gv_profile_start(gvc, g);
+    gv_span_begin("gvLayoutJobs");
     gv_fixLocale (1);
+    gv_span_begin("graph_init");
     graph_init(g, !!(gvc->layout.features->flags & LAYOUT_USES_RANKDIR));
+    gv_span_end();
     GD_drawing(agroot(g)) = GD_drawing(g);
     gv_initShapes ();
     if (gvle && gvle->layout) {
@@ -89,6 +94,9 @@ int gvLayoutJobs(GVC_t * gvc, Agraph_t * g)
 	    GD_cleanup(g) = gvle->cleanup;
     }
     gv_fixLocale (0);
+    gv_span_end();
+    if (profiled)
+	gv_profile_suspend(gvc);
     return 0;
 }
 
@@ -105,7 +113,9 @@ bool gvLayoutDone(Agraph_t * g)
  */
 int gvFreeLayout(GVC_t * gvc, Agraph_t * g)
 {
-    (void)gvc;
+    /* a profile of g not completed by a render ends here */
+    if (gvc)
+	gv_profile_release(gvc, g);
 
     /* skip if no Agraphinfo_t yet */
     if (! agbindrec(g, "Agraphinfo_t", 0, true))
@@ -70,6 +70,7 @@ int gvrender_select(GVJ_t * job, const char *str)
 	job->render.type = plugin->typestr;
 
 	job->flags |= job->render.features->flags;
+	textspan_cache_renderer(gvc, job->render.features->flags);
 
 	if (job->device.engine)
 	    job->render.id = typeptr->id;
@@ -350,13 +350,14 @@ void dijkstra_f(int vertex, vtx_data * graph, int n, float *dist)
     free(index);
 }
 
-// single source shortest paths that also builds terms as it goes
+// single source shortest paths that also builds terms as it goes, if terms is
+// not NULL. dists receives the path lengths, FLT_MAX for unreachable nodes.
 // mostly copied from dijkstra_f above
 // returns the number of terms built
-int dijkstra_sgd(graph_sgd *graph, int source, term_sgd *terms) {
+static int dijkstra_sgd_run(graph_sgd *graph, int source, float *dists,
+                            term_sgd *terms) {
     heap h;
     int *indices = N_GNEW(graph->n, int);
-    float *dists = N_GNEW(graph->n, float);
     for (size_t i= 0; i < graph->n; i++) {
         dists[i] = FLT_MAX;
     }
@@ -377,7 +378,7 @@ int dijkstra_sgd(graph_sgd *graph, int source, term_sgd *terms) {
         }
         // if the target is fixed then always create a term as shortest paths are not calculated from there
         // if not fixed then only create a term if the target index is lower
-        if (bitarray_get(graph->pinneds, closest) || closest<source) {
+        if (terms && (bitarray_get(graph->pinneds, closest) || closest<source)) {
             terms[offset].i = source;
             terms[offset].j = closest;
             terms[offset].d = d;
@@ -394,6 +395,16 @@ int dijkstra_sgd(graph_sgd *graph, int source, term_sgd *terms) {
     }
     freeHeap(&h);
     free(indices);
+    return offset;
+}
+
+int dijkstra_sgd(graph_sgd *graph, int source, term_sgd *terms) {
+    float *dists = N_GNEW(graph->n, float);
+    int offset = dijkstra_sgd_run(graph, source, dists, terms);
     free(dists);
     return offset;
 }
+
+void dijkstra_sgd_dists(graph_sgd *graph, int source, float *dists) {
+    (void)dijkstra_sgd_run(graph, source, dists, NULL);
+}
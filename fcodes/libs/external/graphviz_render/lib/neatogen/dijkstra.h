@@ -24,6 +24,8 @@ extern "C" {
     extern int dijkstra_bounded(int, vtx_data *, int, DistType *, int,
 				int *);
     extern int dijkstra_sgd(graph_sgd *, int, term_sgd *);
+    /* shortest path lengths from a source, FLT_MAX if unreachable */
+    extern void dijkstra_sgd_dists(graph_sgd *, int, float *);
 
 #ifdef __cplusplus
 }
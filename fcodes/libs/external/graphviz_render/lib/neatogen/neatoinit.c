@@ -32,6 +32,7 @@
 #endif
 #include <neatogen/kkutils.h>
 #include <common/pointset.h>
+#include <common/profile.h>
 #include <neatogen/sgd.h>
 #include <cgraph/alloc.h>
 #include <cgraph/bitarray.h>
@@ -667,6 +668,8 @@ static int neatoMode(graph_t * g)
 	    mode = MODE_MAJOR;
 	else if (streq(str, "sgd"))
 		mode = MODE_SGD;
+	else if (streq(str, "sparse_sgd"))
+		mode = MODE_SPARSE_SGD;
 #ifdef DIGCOLA
 	else if (streq(str, "hier"))
 	    mode = MODE_HIER;
@@ -1238,6 +1241,8 @@ majorization(graph_t *mg, graph_t * g, int nv, int mode, int model, int dim, adj
 	    ND_pos(v)[i] = coords[i][idx];
 	}
     }
+    if (rv >= 0)
+	gv_count("neato_iterations", rv);
     freeGraphData(gp);
     free(coords[0]);
     free(coords);
@@ -1331,7 +1336,7 @@ neatoLayout(Agraph_t * mg, Agraph_t * g, int layoutMode, int layoutModel,
 	MaxIter = atoi(str);
     else if (layoutMode == MODE_MAJOR)
 	MaxIter = DFLT_ITERATIONS;
-    else if (layoutMode == MODE_SGD)
+    else if (layoutMode == MODE_SGD || layoutMode == MODE_SPARSE_SGD)
 	MaxIter = 30;
     else
 	MaxIter = 100 * agnnodes(g);
@@ -1339,12 +1344,20 @@ neatoLayout(Agraph_t * mg, Agraph_t * g, int layoutMode, int layoutModel,
     nG = scan_graph_mode(g, layoutMode);
     if (nG < 2 || MaxIter < 0)
 	return;
-    if (layoutMode == MODE_KK)
+    if (layoutMode == MODE_KK) {
+	gv_span_begin("neato_kk");
 	kkNeato(g, nG, layoutModel);
-    else if (layoutMode == MODE_SGD)
+    } else if (layoutMode == MODE_SGD) {
+	gv_span_begin("neato_sgd");
 	sgd(g, layoutModel);
-    else
+    } else if (layoutMode == MODE_SPARSE_SGD) {
+	gv_span_begin("neato_sparse_sgd");
+	sparse_sgd(g, layoutModel);
+    } else {
+	gv_span_begin("neato_majorization");
 	majorization(mg, g, nG, layoutMode, layoutModel, Ndim, am);
+    }
+    gv_span_end();
 }
 
 /* addZ;
@@ -1,5 +1,7 @@
 #include <assert.h>
 #include <cgraph/bitarray.h>
+#include <common/profile.h>
+#include <float.h>
 #include <limits.h>
 #include <neatogen/neato.h>
 #include <neatogen/sgd.h>
@@ -36,6 +38,15 @@ static void fisheryates_shuffle(term_sgd *terms, int n_terms) {
     }
 }
 
+// seed the shuffling of terms from the start attribute, as the initial
+// positions are seeded, so that start=random5 also varies the order of
+// updates; without a seed in start, the order is the same on every run
+static void seed_shuffle(graph_t *G) {
+    long seed = 0;
+    (void)setSeed(G, INIT_RANDOM, &seed);
+    rk_seed((unsigned long)seed, &rstate);
+}
+
 // graph_sgd data structure exists only to make dijkstras faster
 static graph_sgd * extract_adjacency(graph_t *G, int model) {
     node_t *np;
@@ -143,9 +154,8 @@ static void free_adjacency(graph_sgd *graph) {
 }
 
 
-void sgd(graph_t *G, /* input graph */
-        int model /* distance model */)
-{
+// shortest path terms are only supported for these models
+static int supported_model(int model) {
     if (model == MODEL_CIRCUIT) {
         agerr(AGWARN, "circuit model not yet supported in Gmode=sgd, reverting to shortpath model\n");
         model = MODEL_SHORTPATH;
@@ -154,6 +164,35 @@ void sgd(graph_t *G, /* input graph */
         agerr(AGWARN, "mds model not yet supported in Gmode=sgd, reverting to shortpath model\n");
         model = MODEL_SHORTPATH;
     }
+    return model;
+}
+
+// initialise starting positions and copy them into temporary space for speed
+static float *load_positions(graph_t *G, int n) {
+    initial_positions(G, n);
+    float *pos = N_NEW(2*n, float);
+    for (int i=0; i<n; i++) {
+        node_t *node = GD_neato_nlist(G)[i];
+        pos[2*i] = ND_pos(node)[0];
+        pos[2*i+1] = ND_pos(node)[1];
+    }
+    return pos;
+}
+
+// copy temporary positions back into graph_t
+static void store_positions(graph_t *G, int n, float *pos) {
+    for (int i=0; i<n; i++) {
+        node_t *node = GD_neato_nlist(G)[i];
+        ND_pos(node)[0] = pos[2*i];
+        ND_pos(node)[1] = pos[2*i+1];
+    }
+    free(pos);
+}
+
+void sgd(graph_t *G, /* input graph */
+        int model /* distance model */)
+{
+    model = supported_model(model);
     int n = agnnodes(G);
 
     if (Verbose) {
@@ -169,15 +208,34 @@ void sgd(graph_t *G, /* input graph */
         }
     }
     term_sgd *terms = N_NEW(n_terms, term_sgd);
+    // the terms of each source start after those of the sources before it, a
+    // source having a term for every node with a lower index and every fixed
+    // node with a higher one, so the shortest paths from each source can be
+    // calculated apart
+    int n_pinned = n - n_fixed;
+    int *offsets = N_NEW(n + 1, int);
+    for (i=0; i<n; i++) {
+        if (isFixed(GD_neato_nlist(G)[i])) {
+            n_pinned--;
+            offsets[i+1] = offsets[i];
+        } else {
+            offsets[i+1] = offsets[i] + i + n_pinned;
+        }
+    }
+    assert(offsets[n] == n_terms);
     // calculate term values through shortest paths
-    int offset = 0;
     graph_sgd *graph = extract_adjacency(G, model);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
     for (i=0; i<n; i++) {
         if (!isFixed(GD_neato_nlist(G)[i])) {
-            offset += dijkstra_sgd(graph, i, terms+offset);
+            int built = dijkstra_sgd(graph, i, terms+offsets[i]);
+            assert(built == offsets[i+1] - offsets[i]);
+            (void)built;
         }
     }
-    assert(offset == n_terms);
+    free(offsets);
     free_adjacency(graph);
     if (Verbose) {
         fprintf(stderr, " %.2f sec\n", elapsed_sec());
@@ -198,16 +256,10 @@ void sgd(graph_t *G, /* input graph */
     float eta_min = Epsilon / w_max;
     float lambda = log(eta_max/eta_min) / (MaxIter-1);
 
-    // initialise starting positions (from neatoprocs)
-    initial_positions(G, n);
-    // copy initial positions and state into temporary space for speed
-    float *pos = N_NEW(2*n, float);
+    float *pos = load_positions(G, n);
     bool *unfixed = N_NEW(n, bool);
     for (i=0; i<n; i++) {
-        node_t *node = GD_neato_nlist(G)[i];
-        pos[2*i] = ND_pos(node)[0];
-        pos[2*i+1] = ND_pos(node)[1];
-        unfixed[i] = !isFixed(node);
+        unfixed[i] = !isFixed(GD_neato_nlist(G)[i]);
     }
 
     // perform optimisation
@@ -216,7 +268,7 @@ void sgd(graph_t *G, /* input graph */
         start_timer();
     }
     int t;
-    rk_seed(0, &rstate); // TODO: get seed from graph
+    seed_shuffle(G);
     for (t=0; t<MaxIter; t++) {
         fisheryates_shuffle(terms, n_terms);
         float eta = eta_max * exp(-lambda * t);
@@ -247,17 +299,276 @@ void sgd(graph_t *G, /* input graph */
             fprintf(stderr, " %.3f", calculate_stress(pos, terms, n_terms));
         }
     }
+    gv_count("neato_iterations", t);
     if (Verbose) {
         fprintf(stderr, "\nfinished in %.2f sec\n", elapsed_sec());
     }
     free(terms);
 
-    // copy temporary positions back into graph_t
-    for (i=0; i<n; i++) {
-        node_t *node = GD_neato_nlist(G)[i];
-        ND_pos(node)[0] = pos[2*i];
-        ND_pos(node)[1] = pos[2*i+1];
-    }
-    free(pos);
+    store_positions(G, n, pos);
     free(unfixed);
 }
+
+// The sparse model of Zheng, Pawar and Goodman, "Graph Drawing by Stochastic
+// Gradient Descent", replaces the terms between all pairs of nodes by terms
+// between adjacent nodes plus terms between every node and a few pivots. The
+// term between a node and a pivot stands in for the nodes that are closer to
+// that pivot than to any other, so it is weighted by how many of them lie
+// between the two. This needs O(n * SPARSE_SGD_PIVOTS + edges) memory instead
+// of O(n²).
+
+// number of pivots of the sparse model
+#define SPARSE_SGD_PIVOTS 50
+
+// smallest distance of a term, to which shorter ones, such as that of an edge
+// of len=0, are raised so that their weight 1/d² stays finite
+#define SPARSE_SGD_MIN_DIST 1e-3f
+
+// a term of the sparse model, which may move its two nodes by different amounts
+typedef struct {
+    int i, j;
+    float d;
+    float w_i, w_j; // weight of the term for moving i and j, 0 to keep it still
+} term_sparse_sgd;
+
+static float calculate_sparse_stress(float *pos, term_sparse_sgd *terms, size_t n_terms) {
+    float stress = 0;
+    for (size_t ij = 0; ij < n_terms; ij++) {
+        float dx = pos[2*terms[ij].i] - pos[2*terms[ij].j];
+        float dy = pos[2*terms[ij].i+1] - pos[2*terms[ij].j+1];
+        float r = hypotf(dx, dy) - terms[ij].d;
+        stress += (terms[ij].w_i + terms[ij].w_j) / 2 * (r * r);
+    }
+    return stress;
+}
+
+static void fisheryates_shuffle_sparse(term_sparse_sgd *terms, size_t n_terms) {
+    for (size_t i = n_terms - 1; i >= 1; i--) {
+        size_t j = (size_t)rk_interval(i, &rstate);
+
+        term_sparse_sgd temp = terms[i];
+        terms[i] = terms[j];
+        terms[j] = temp;
+    }
+}
+
+static int cmp_float(const void *a, const void *b) {
+    const float *x = a;
+    const float *y = b;
+    return (*x > *y) - (*x < *y);
+}
+
+// number of distances in the sorted array dists of length n that are <= d
+static size_t count_within(const float *dists, size_t n, float d) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (dists[mid] <= d) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void add_sparse_term(graph_sgd *graph, term_sparse_sgd *terms, size_t *n_terms,
+                            size_t i, size_t j, float d, float w_i, float w_j) {
+    if (bitarray_get(graph->pinneds, i))
+        w_i = 0;
+    if (bitarray_get(graph->pinneds, j))
+        w_j = 0;
+    if (w_i == 0 && w_j == 0)
+        return;
+    terms[*n_terms].i = (int)i;
+    terms[*n_terms].j = (int)j;
+    terms[*n_terms].d = d;
+    terms[*n_terms].w_i = w_i;
+    terms[*n_terms].w_j = w_j;
+    (*n_terms)++;
+}
+
+static term_sparse_sgd *sparse_terms(graph_sgd *graph, size_t *n_terms) {
+    const size_t n = graph->n;
+    const size_t n_pivots = n < SPARSE_SGD_PIVOTS ? n : SPARSE_SGD_PIVOTS;
+
+    // pick pivots that are far from each other, each one the node farthest
+    // from those picked so far, and partition the nodes into the regions
+    // closest to each pivot
+    float *dists = N_NEW(n_pivots * n, float); // from pivot k to node i at [k*n+i]
+    size_t *pivots = N_NEW(n_pivots, size_t);
+    float *nearest = N_NEW(n, float); // distance to the closest pivot
+    size_t *region = N_NEW(n, size_t); // index of the closest pivot
+    for (size_t i = 0; i < n; i++) {
+        nearest[i] = FLT_MAX;
+        region[i] = n_pivots; // no pivot reaches it (yet)
+    }
+    size_t p = 0;
+    for (size_t k = 0; k < n_pivots; k++) {
+        pivots[k] = p;
+        assert(p <= INT_MAX);
+        dijkstra_sgd_dists(graph, (int)p, &dists[k * n]);
+        for (size_t i = 0; i < n; i++) {
+            if (dists[k * n + i] < nearest[i]) {
+                nearest[i] = dists[k * n + i];
+                region[i] = k;
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (nearest[i] > nearest[p]) {
+                p = i;
+            }
+        }
+    }
+
+    // distances from each pivot to the nodes in its region, sorted
+    size_t *region_start = N_NEW(n_pivots + 1, size_t);
+    for (size_t i = 0; i < n; i++) {
+        if (region[i] < n_pivots) {
+            region_start[region[i] + 1]++;
+        }
+    }
+    for (size_t k = 0; k < n_pivots; k++) {
+        region_start[k + 1] += region_start[k];
+    }
+    float *region_dists = N_NEW(n, float);
+    size_t *fill = N_NEW(n_pivots, size_t);
+    for (size_t i = 0; i < n; i++) {
+        if (region[i] < n_pivots) {
+            region_dists[region_start[region[i]] + fill[region[i]]++] = nearest[i];
+        }
+    }
+    free(fill);
+    for (size_t k = 0; k < n_pivots; k++) {
+        qsort(&region_dists[region_start[k]], region_start[k + 1] - region_start[k],
+              sizeof(float), cmp_float);
+    }
+
+    term_sparse_sgd *terms = N_NEW(graph->sources[n] + n * n_pivots, term_sparse_sgd);
+    size_t *neighbour_of = N_NEW(n, size_t); // i + 1 if adjacent to node i
+    *n_terms = 0;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t x = graph->sources[i]; x < graph->sources[i + 1]; x++) {
+            size_t j = graph->targets[x];
+            if (neighbour_of[j] == i + 1) { // ignore multiedges
+                continue;
+            }
+            neighbour_of[j] = i + 1;
+            if (j > i) {
+                float d = fmaxf(graph->weights[x], SPARSE_SGD_MIN_DIST);
+                add_sparse_term(graph, terms, n_terms, i, j, d, 1 / (d*d), 1 / (d*d));
+            }
+        }
+
+        const bool is_pivot = region[i] < n_pivots && pivots[region[i]] == i;
+        for (size_t k = 0; k < n_pivots; k++) {
+            float d = dists[k * n + i];
+            if (pivots[k] == i || neighbour_of[pivots[k]] == i + 1 || d == FLT_MAX) {
+                continue;
+            }
+            d = fmaxf(d, SPARSE_SGD_MIN_DIST);
+            // two pivots share one term, added from the one picked later
+            if (is_pivot && region[i] < k) {
+                continue;
+            }
+            // weighted by the nodes of the region that are closer to its pivot
+            // than half way to i
+            float w_i = count_within(&region_dists[region_start[k]],
+                                     region_start[k + 1] - region_start[k], d / 2) / (d*d);
+            float w_p = 0;
+            if (is_pivot) {
+                w_p = count_within(&region_dists[region_start[region[i]]],
+                                   region_start[region[i] + 1] - region_start[region[i]],
+                                   d / 2) / (d*d);
+            }
+            add_sparse_term(graph, terms, n_terms, i, pivots[k], d, w_i, w_p);
+        }
+    }
+
+    free(neighbour_of);
+    free(region_dists);
+    free(region_start);
+    free(region);
+    free(nearest);
+    free(pivots);
+    free(dists);
+    return terms;
+}
+
+void sparse_sgd(graph_t *G, /* input graph */
+        int model /* distance model */)
+{
+    model = supported_model(model);
+    int n = agnnodes(G);
+
+    if (Verbose) {
+        fprintf(stderr, "calculating pivot distances and setting up stress terms:");
+        start_timer();
+    }
+    graph_sgd *graph = extract_adjacency(G, model);
+    size_t n_terms;
+    term_sparse_sgd *terms = sparse_terms(graph, &n_terms);
+    free_adjacency(graph);
+    if (Verbose) {
+        fprintf(stderr, " %zu terms, %.2f sec\n", n_terms, elapsed_sec());
+    }
+
+    float *pos = load_positions(G, n);
+    if (n_terms == 0) {
+        free(terms);
+        store_positions(G, n, pos);
+        return;
+    }
+
+    // initialise annealing schedule, as in sgd()
+    float w_min = FLT_MAX, w_max = 0;
+    for (size_t ij = 0; ij < n_terms; ij++) {
+        float ws[] = {terms[ij].w_i, terms[ij].w_j};
+        for (size_t k = 0; k < sizeof(ws) / sizeof(ws[0]); k++) {
+            if (ws[k] > 0 && ws[k] < w_min)
+                w_min = ws[k];
+            if (ws[k] > w_max)
+                w_max = ws[k];
+        }
+    }
+    float eta_max = 1 / w_min;
+    float eta_min = Epsilon / w_max;
+    float lambda = log(eta_max/eta_min) / (MaxIter-1);
+
+    // perform optimisation
+    if (Verbose) {
+        fprintf(stderr, "solving model:");
+        start_timer();
+    }
+    seed_shuffle(G);
+    for (int t = 0; t < MaxIter; t++) {
+        fisheryates_shuffle_sparse(terms, n_terms);
+        float eta = eta_max * exp(-lambda * t);
+        for (size_t ij = 0; ij < n_terms; ij++) {
+            const term_sparse_sgd *term = &terms[ij];
+            // cap step sizes
+            float mu_i = fminf(eta * term->w_i, 1);
+            float mu_j = fminf(eta * term->w_j, 1);
+
+            float dx = pos[2*term->i] - pos[2*term->j];
+            float dy = pos[2*term->i+1] - pos[2*term->j+1];
+            float mag = hypotf(dx, dy);
+
+            float r = (mag - term->d) / (2*mag);
+            pos[2*term->i] -= mu_i * r * dx;
+            pos[2*term->i+1] -= mu_i * r * dy;
+            pos[2*term->j] += mu_j * r * dx;
+            pos[2*term->j+1] += mu_j * r * dy;
+        }
+        if (Verbose) {
+            fprintf(stderr, " %.3f", calculate_sparse_stress(pos, terms, n_terms));
+        }
+    }
+    gv_count("neato_iterations", MaxIter);
+    if (Verbose) {
+        fprintf(stderr, "\nfinished in %.2f sec\n", elapsed_sec());
+    }
+    free(terms);
+
+    store_positions(G, n, pos);
+}
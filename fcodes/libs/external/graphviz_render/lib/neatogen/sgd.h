@@ -22,6 +22,7 @@ typedef struct graph_sgd {
 } graph_sgd;
 
 extern void sgd(graph_t *, int);
+extern void sparse_sgd(graph_t *, int);
 
 #ifdef __cplusplus
 }
@@ -680,28 +680,43 @@ finish0:
     return iterations;
 }
 
+/* packed_row:
+ * Index in a packed distance matrix of the entry for nodes i and i, the
+ * first of row i, which holds the distances from i to nodes i to n-1.
+ */
+static size_t packed_row(int i, int n)
+{
+    return (size_t)i * (size_t)(2 * n - i + 1) / 2;
+}
+
 /* compute_weighted_apsp_packed:
  * Edge lengths can be any float > 0
  */
 static float *compute_weighted_apsp_packed(vtx_data * graph, int n)
 {
-    int i, j, count;
+    int i;
     float *Dij = N_NEW(n * (n + 1) / 2, float);
 
-    float *Di = N_NEW(n, float);
-    Queue Q;
-
-    mkQueue(&Q, n);
-
-    count = 0;
-    for (i = 0; i < n; i++) {
-	dijkstra_f(i, graph, n, Di);
-	for (j = i; j < n; j++) {
-	    Dij[count++] = Di[j];
+    /* rows are independent, so sources are run in parallel, each thread
+     * with a distance vector of its own */
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+	float *Di = N_NEW(n, float);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+	for (i = 0; i < n; i++) {
+	    float *row = Dij + packed_row(i, n);
+	    int j;
+	    dijkstra_f(i, graph, n, Di);
+	    for (j = i; j < n; j++) {
+		row[j - i] = Di[j];
+	    }
 	}
+	free(Di);
     }
-    free(Di);
-    freeQueue(&Q);
     return Dij;
 }
 
@@ -744,19 +759,28 @@ float *mdsModel(vtx_data * graph, int nG)
  */
 float *compute_apsp_packed(vtx_data * graph, int n)
 {
-    int i, j, count;
+    int i;
     float *Dij = N_NEW(n * (n + 1) / 2, float);
 
-    DistType *Di = N_NEW(n, DistType);
-
-    count = 0;
-    for (i = 0; i < n; i++) {
-	bfs(i, graph, n, Di);
-	for (j = i; j < n; j++) {
-	    Dij[count++] = (float)Di[j];
+    /* in parallel, as in compute_weighted_apsp_packed */
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+	DistType *Di = N_NEW(n, DistType);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+	for (i = 0; i < n; i++) {
+	    float *row = Dij + packed_row(i, n);
+	    int j;
+	    bfs(i, graph, n, Di);
+	    for (j = i; j < n; j++) {
+		row[j - i] = (float)Di[j];
+	    }
 	}
+	free(Di);
     }
-    free(Di);
     return Dij;
 }
 
@@ -11,6 +11,7 @@
 
 #include "config.h"
 #include	<cgraph/alloc.h>
+#include	<common/profile.h>
 #include	<math.h>
 #include	<neatogen/neato.h>
 #include	<neatogen/stress.h>
@@ -258,7 +259,7 @@ int scan_graph_mode(graph_t * G, int mode)
 	    ND_heapindex(np) = -1;
 	    total_len += setEdgeLen(G, np, lenx, dfltlen);
 	}
-    } else if (mode == MODE_SGD) {
+    } else if (mode == MODE_SGD || mode == MODE_SPARSE_SGD) {
 	Epsilon = .01;
 	getdouble(G, "epsilon", &Epsilon);
 	GD_neato_nlist(G) = gv_calloc(nV + 1, sizeof(node_t*)); // not sure why but sometimes needs the + 1
@@ -437,6 +438,7 @@ void solve_model(graph_t * G, int nG)
     while ((np = choose_node(G, nG))) {
 	move_node(G, nG, np);
     }
+    gv_count("neato_iterations", GD_move(G));
     if (Verbose) {
 	fprintf(stderr, "\nfinal e = %f", total_e(G, nG));
 	fprintf(stderr, " %d%s iterations %.2f sec\n",
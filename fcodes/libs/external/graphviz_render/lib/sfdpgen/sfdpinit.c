@@ -10,6 +10,7 @@
 
 
 #include "config.h"
+#include <common/profile.h>
 #include <limits.h>
 #include <sfdpgen/sfdp.h>
 #include <neatogen/neato.h>
@@ -98,7 +99,9 @@ static void sfdpLayout(graph_t * g, spring_electrical_control ctrl,
 	sizes = NULL;
     pos = getPos(g);
 
+    gv_span_begin("sfdp_multilevel");
     multilevel_spring_electrical_embedding(Ndim, A, D, ctrl, sizes, pos, n_edge_label_nodes, edge_label_nodes, &flag);
+    gv_span_end();
 
     for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
 	double *npos = pos + (Ndim * ND_id(n));
@@ -21,6 +21,7 @@
 #include <neatogen/overlap.h>
 #include <common/types.h>
 #include <common/arith.h>
+#include <common/profile.h>
 #include <math.h>
 #include <common/globals.h>
 #include <stdbool.h>
@@ -403,7 +404,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
   double *f = NULL, dist, F, Fnorm = 0, Fnorm0;
   int iter = 0;
   int adaptive_cooling = ctrl->adaptive_cooling;
-  QuadTree qt = NULL;
+  FlatQuadTree qt = NULL;
   double counts[4], *force = NULL;
 #ifdef TIME
   clock_t start, end, start0;
@@ -444,6 +445,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
   CRK = pow(C, (2.-p)/3.)/K;
 
   force = gv_calloc(dim * n, sizeof(double));
+  qt = FlatQuadTree_new(dim);
 
   do {
 #ifdef TIME
@@ -459,7 +461,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
 #ifdef TIME
     start = clock();
 #endif
-    qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x);
+    FlatQuadTree_build(qt, n, max_qtree_level, x);
 
 #ifdef TIME
     qtree_new_cpu += ((double) (clock() - start))/CLOCKS_PER_SEC;
@@ -470,7 +472,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
     start = clock();
 #endif
 
-    QuadTree_get_repulsive_force(qt, force, x, ctrl->bh, p, KP, counts);
+    FlatQuadTree_get_repulsive_force(qt, force, ctrl->bh, p, KP, counts);
 
 #ifdef TIME
     end = clock();
@@ -503,40 +505,23 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
 
 
 
-    if (qt) {
-#ifdef TIME
-      start = clock();
-#endif
-      QuadTree_delete(qt);
 #ifdef TIME
-      end = clock();
-      qtree_new_cpu += ((double) (end - start)) / CLOCKS_PER_SEC;
-#endif
-
-#ifdef TIME
-      qtree_cpu0 = qtree_cpu - qtree_cpu0;
-      qtree_new_cpu0 = qtree_new_cpu - qtree_new_cpu0;
-      /*      if (Verbose) fprintf(stderr, "\r iter=%d cpu=%.2f, quadtree=%.2f quad_force=%.2f other=%.2f counts={%.2f,%.2f,%.2f} step=%f Fnorm=%f nz=%d  K=%f qtree_lev = %d",
+    qtree_cpu0 = qtree_cpu - qtree_cpu0;
+    qtree_new_cpu0 = qtree_new_cpu - qtree_new_cpu0;
+    /*      if (Verbose) fprintf(stderr, "\r iter=%d cpu=%.2f, quadtree=%.2f quad_force=%.2f other=%.2f counts={%.2f,%.2f,%.2f} step=%f Fnorm=%f nz=%d  K=%f qtree_lev = %d",
 			   iter, ((double) (clock() - start2)) / CLOCKS_PER_SEC, qtree_new_cpu0,
 			   qtree_cpu0,((double) (clock() - start2))/CLOCKS_PER_SEC - qtree_cpu0 - qtree_new_cpu0,
 			   counts[0], counts[1], counts[2],
 			   step, Fnorm, A->nz,K,max_qtree_level);
-      */
-      qtree_cpu0 = qtree_cpu;
-      qtree_new_cpu0 = qtree_new_cpu;
-#endif
-      oned_optimizer_train(qtree_level_optimizer, counts[0]+0.85*counts[1]+3.3*counts[2]);
-    } else {
-      if (Verbose) {
-        fprintf(stderr, "\r                iter = %d, step = %f Fnorm = %f nz = %d  K = %f                                  ",iter, step, Fnorm, A->nz,K);
-#ifdef ENERGY
-        fprintf(stderr, "energy = %f\n",spring_electrical_energy(dim, A, x, p, CRK, KP));
+    */
+    qtree_cpu0 = qtree_cpu;
+    qtree_new_cpu0 = qtree_new_cpu;
 #endif
-      }
-    }
+    oned_optimizer_train(qtree_level_optimizer, counts[0]+0.85*counts[1]+3.3*counts[2]);
 
     step = update_step(adaptive_cooling, step, Fnorm, Fnorm0, cool);
   } while (step > tol && iter < maxiter);
+  gv_count("sfdp_iterations", iter);
 
 #ifdef DEBUG_PRINT
   if (Verbose && 0) fputs("\n", stderr);
@@ -562,6 +547,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
   ctrl->max_qtree_level = max_qtree_level;
 
   if (A != A0) SparseMatrix_delete(A);
+  FlatQuadTree_delete(qt);
   free(force);
 }
 
@@ -692,6 +678,7 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0, spring_el
 
     step = update_step(adaptive_cooling, step, Fnorm, Fnorm0, cool);
   } while (step > tol && iter < maxiter);
+  gv_count("sfdp_iterations", iter);
 
 #ifdef DEBUG_PRINT
   if (Verbose && 0) fputs("\n", stderr);
@@ -910,6 +897,7 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
 
     step = update_step(adaptive_cooling, step, Fnorm, Fnorm0, cool);
   } while (step > tol && iter < maxiter);
+  gv_count("sfdp_iterations", iter);
 
 #ifdef DEBUG_PRINT
   if (Verbose && 0) fputs("\n", stderr);
@@ -1111,6 +1099,7 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
 
     step = update_step(adaptive_cooling, step, Fnorm, Fnorm0, cool);
   } while (step > tol && iter < maxiter);
+  gv_count("sfdp_iterations", iter);
 
 #ifdef DEBUG_PRINT
   if (Verbose && 0) fputs("\n", stderr);
@@ -1497,6 +1486,8 @@ static void multilevel_spring_electrical_embedding_core(int dim, SparseMatrix A0
       }
     }
 #endif
+    gv_span_begin("sfdp_level");
+    gv_count("sfdp_levels", 1);
     if (ctrl->tscheme == QUAD_TREE_NONE){
       spring_electrical_embedding_slow(dim, grid->A, ctrl, xc, flag);
     } else if (ctrl->tscheme == QUAD_TREE_FAST || (ctrl->tscheme == QUAD_TREE_HYBRID && grid->A->m > QUAD_TREE_HYBRID_SIZE)){
@@ -1507,6 +1498,7 @@ static void multilevel_spring_electrical_embedding_core(int dim, SparseMatrix A0
     } else {
       spring_electrical_embedding(dim, grid->A, ctrl, xc, flag);
     }
+    gv_span_end();
     if (Multilevel_is_finest(grid)) break;
     if (*flag) {
       free(xc);
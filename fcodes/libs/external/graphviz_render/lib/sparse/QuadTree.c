@@ -16,6 +16,8 @@
 #include <sparse/LinkedList.h>
 #include <sparse/QuadTree.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 
 extern double distance_cropped(double *x, int dim, int i, int j);
 
@@ -709,3 +711,474 @@ void QuadTree_get_nearest(QuadTree qt, double *x, double *ymin, int *imin, doubl
   QuadTree_get_nearest_internal(qt, x, ymin, min, imin, true);
   QuadTree_get_nearest_internal(qt, x, ymin, min, imin, false);
 }
+
+/* the flat quadtree used for repulsive forces */
+
+#define MORTON_BITS 63 /* usable bits of a Morton code */
+
+/* In builds with OpenMP and with at least FLAT_PARALLEL_MIN points, the dual
+   tree traversal is split into at least FLAT_TASKS_MIN pairs of cells, dealt
+   round robin to FLAT_BLOCKS blocks. Each block accumulates into forces of its
+   own and may run on a thread of its own. The blocks are then summed in a fixed
+   order, so forces do not depend on the number of threads or on how they are
+   scheduled. Without OpenMP, the buffers of the blocks would only cost time,
+   so the traversal runs as one. */
+#define FLAT_PARALLEL_MIN 4096
+#define FLAT_TASKS_MIN 256
+#define FLAT_BLOCKS 8
+
+typedef struct {
+  uint64_t code;/* interleaved cell coordinates of the point, one dim bits per level */
+  int id;/* index of the point in the coordinates given to FlatQuadTree_build */
+} morton_point;
+
+typedef struct {
+  int c1, c2;
+} cell_pair;
+
+typedef struct {
+  int n;/* number of points */
+  int first_child;/* index of the first child, or -1 for a leaf */
+  int n_children;/* number of nonempty children, stored consecutively */
+  int first_point;/* index in Morton order of the first point in the cell */
+  double width;
+} flat_cell;
+
+struct FlatQuadTree_struct {
+  int dim;
+  int n;/* number of points */
+  int levels;/* number of levels below the root */
+  int n_cells;
+  int cells_cap;
+  flat_cell *cells;/* root first, children always after their parent */
+  double *center;/* center of cell c at [c*dim, c*dim+dim-1] */
+  double *average;/* average of the points of cell c, laid out as center */
+  double *cell_force;/* force on cell c, laid out as center */
+  int points_cap;
+  morton_point *order;/* points sorted by Morton code */
+  double *coord;/* coordinate k of the j-th point in Morton order at [k*n+j] */
+  double *force;/* force on the j-th point in Morton order, laid out as coord */
+  /* the traversal split into blocks, see FLAT_BLOCKS */
+  int tasks_cap;
+  cell_pair *tasks;
+  cell_pair *next_tasks;
+  int block_points_cap;
+  double *block_force;/* force of blocks 1 and up, laid out as force */
+  int block_cells_cap;
+  double *block_cell_force;/* cell force of blocks 1 and up, laid out as cell_force */
+};
+
+FlatQuadTree FlatQuadTree_new(int dim){
+  FlatQuadTree qt = gv_alloc(sizeof(struct FlatQuadTree_struct));
+  assert(dim > 0);
+  qt->dim = dim;
+  return qt;
+}
+
+void FlatQuadTree_delete(FlatQuadTree qt){
+  if (!qt) return;
+  free(qt->cells);
+  free(qt->center);
+  free(qt->average);
+  free(qt->cell_force);
+  free(qt->order);
+  free(qt->coord);
+  free(qt->force);
+  free(qt->tasks);
+  free(qt->next_tasks);
+  free(qt->block_force);
+  free(qt->block_cell_force);
+  free(qt);
+}
+
+/* reserve count consecutive cells, returning the index of the first */
+static int flat_cell_alloc(FlatQuadTree qt, int count){
+  int dim = qt->dim, first = qt->n_cells;
+
+  if (qt->n_cells + count > qt->cells_cap){
+    int cap = MAX(2*qt->cells_cap, qt->n_cells + count);
+    qt->cells = gv_recalloc(qt->cells, qt->cells_cap, cap, sizeof(flat_cell));
+    qt->center = gv_recalloc(qt->center, dim*qt->cells_cap, dim*cap, sizeof(double));
+    qt->average = gv_recalloc(qt->average, dim*qt->cells_cap, dim*cap, sizeof(double));
+    qt->cell_force = gv_recalloc(qt->cell_force, dim*qt->cells_cap, dim*cap, sizeof(double));
+    qt->cells_cap = cap;
+  }
+  qt->n_cells += count;
+  return first;
+}
+
+static int morton_point_cmp(const void *a, const void *b){
+  const morton_point *p = a;
+  const morton_point *q = b;
+  if (p->code != q->code) return p->code < q->code ? -1 : 1;
+  return (p->id > q->id) - (p->id < q->id);
+}
+
+/* quadrant of the j-th point at the given level, numbered as in QuadTree_get_quadrant */
+static int flat_quadrant(FlatQuadTree qt, int j, int level){
+  int dim = qt->dim;
+  return (int)((qt->order[j].code >> (dim*(qt->levels - 1 - level))) & ((1u << dim) - 1));
+}
+
+/* fill in cell c, holding the points [lo, hi) in Morton order, and its subtree.
+   The center and width of c are set by the caller. */
+static void flat_cell_build(FlatQuadTree qt, int c, int lo, int hi, int level){
+  int dim = qt->dim, n = qt->n, j, k, child, start, q;
+  double sum, width;
+
+  qt->cells[c].n = hi - lo;
+  qt->cells[c].first_point = lo;
+  qt->cells[c].first_child = -1;
+  qt->cells[c].n_children = 0;
+
+  if (hi - lo == 1 || level >= qt->levels){
+    for (k = 0; k < dim; k++){
+      sum = 0;
+      for (j = lo; j < hi; j++) sum += qt->coord[k*n+j];
+      qt->average[c*dim+k] = sum/(hi - lo);
+    }
+    return;
+  }
+
+  /* points of a child are a run of equal quadrants */
+  int n_children = 1;
+  for (j = lo + 1; j < hi; j++){
+    if (flat_quadrant(qt, j, level) != flat_quadrant(qt, j - 1, level)) n_children++;
+  }
+  child = flat_cell_alloc(qt, n_children);
+  qt->cells[c].first_child = child;
+  qt->cells[c].n_children = n_children;
+
+  width = qt->cells[c].width/2;
+  for (start = lo, j = lo + 1; j <= hi; j++){
+    if (j < hi && flat_quadrant(qt, j, level) == flat_quadrant(qt, start, level)) continue;
+    q = flat_quadrant(qt, start, level);
+    for (k = 0; k < dim; k++){
+      qt->center[child*dim+k] = qt->center[c*dim+k] + ((q >> k) & 1 ? width : -width);
+    }
+    qt->cells[child].width = width;
+    flat_cell_build(qt, child, start, j, level + 1);
+    child++;
+    start = j;
+  }
+
+  for (k = 0; k < dim; k++){
+    sum = 0;
+    for (child = qt->cells[c].first_child; child < qt->cells[c].first_child + n_children; child++){
+      sum += qt->cells[child].n*qt->average[child*dim+k];
+    }
+    qt->average[c*dim+k] = sum/(hi - lo);
+  }
+}
+
+void FlatQuadTree_build(FlatQuadTree qt, int n, int max_level, double *coord){
+  int dim = qt->dim, i, k, b;
+  double *xmin, *xmax, width, scale, g;
+  uint64_t gmax, cell, code;
+
+  assert(n > 0);
+  if (n > qt->points_cap){
+    qt->order = gv_recalloc(qt->order, qt->points_cap, n, sizeof(morton_point));
+    qt->coord = gv_recalloc(qt->coord, dim*qt->points_cap, dim*n, sizeof(double));
+    qt->force = gv_recalloc(qt->force, dim*qt->points_cap, dim*n, sizeof(double));
+    qt->points_cap = n;
+  }
+  qt->n = n;
+  qt->levels = MAX(0, MIN(max_level, MORTON_BITS/dim));
+  qt->n_cells = 0;
+
+  /* the root box, as in QuadTree_new_from_point_list */
+  xmin = gv_calloc(dim, sizeof(double));
+  xmax = gv_calloc(dim, sizeof(double));
+  for (k = 0; k < dim; k++) xmin[k] = xmax[k] = coord[k];
+  for (i = 1; i < n; i++){
+    for (k = 0; k < dim; k++){
+      xmin[k] = fmin(xmin[k], coord[i*dim+k]);
+      xmax[k] = fmax(xmax[k], coord[i*dim+k]);
+    }
+  }
+  width = xmax[0] - xmin[0];
+  for (k = 0; k < dim; k++) width = fmax(width, xmax[k] - xmin[k]);
+  width = fmax(width, 0.00001);
+  width *= 0.52;
+
+  flat_cell_alloc(qt, 1);
+  qt->cells[0].width = width;
+  for (k = 0; k < dim; k++) qt->center[k] = (xmin[k] + xmax[k])*0.5;
+
+  /* Morton code of each point: the cell it falls in at the deepest level, with
+     the bits of all dimensions interleaved so that sorting groups the points
+     of every cell together */
+  gmax = ((uint64_t)1 << qt->levels) - 1;
+  scale = ldexp(1., qt->levels)/(2*width);
+  for (i = 0; i < n; i++){
+    code = 0;
+    for (k = 0; k < dim; k++){
+      g = (coord[i*dim+k] - (qt->center[k] - width))*scale;
+      cell = g <= 0 ? 0 : g >= (double)gmax ? gmax : (uint64_t)g;
+      for (b = 0; b < qt->levels; b++) code |= ((cell >> b) & 1) << (b*dim + k);
+    }
+    qt->order[i].code = code;
+    qt->order[i].id = i;
+  }
+  qsort(qt->order, n, sizeof(morton_point), morton_point_cmp);
+  for (i = 0; i < n; i++){
+    for (k = 0; k < dim; k++) qt->coord[k*n+i] = coord[qt->order[i].id*dim+k];
+  }
+
+  flat_cell_build(qt, 0, 0, n, 0);
+  free(xmin);
+  free(xmax);
+}
+
+/* how the traversal treats a pair of cells */
+typedef enum {
+  FLAT_FAR,/* far enough apart to interact as cells */
+  FLAT_LEAVES,/* both leaves, their points interact */
+  FLAT_SPLIT_BOTH,/* the same cell, pairs of its children are visited */
+  FLAT_SPLIT_FIRST,/* the children of c1 are visited against c2 */
+  FLAT_SPLIT_SECOND,/* the children of c2 are visited against c1 */
+} flat_step;
+
+/* the step for cells c1 and c2, whose averages are dist apart */
+static flat_step flat_pair_step(const struct FlatQuadTree_struct *qt, int c1, int c2, double bh, double *dist){
+  const flat_cell *q1 = &qt->cells[c1], *q2 = &qt->cells[c2];
+  bool leaf1 = q1->first_child < 0, leaf2 = q2->first_child < 0;
+  int dim = qt->dim;
+
+  assert(q1->n > 0 && q2->n > 0);
+
+  *dist = point_distance(&qt->average[c1*dim], &qt->average[c2*dim], dim);
+  if (q1->width + q2->width < bh**dist) return FLAT_FAR;
+  if (leaf1 && leaf2) return FLAT_LEAVES;
+  if (c1 == c2) return FLAT_SPLIT_BOTH;
+
+  /* split the one with bigger box, or one not at the last level */
+  if (q1->width > q2->width && !leaf1) return FLAT_SPLIT_FIRST;
+  if (q2->width > q1->width && !leaf2) return FLAT_SPLIT_SECOND;
+  return leaf1 ? FLAT_SPLIT_SECOND : FLAT_SPLIT_FIRST;
+}
+
+static void FlatQuadTree_repulsive_force_interact(const struct FlatQuadTree_struct *qt, int c1, int c2, double bh, double p, double KP,
+						   double *force, double *cell_force, double *counts){
+  /* the dual tree traversal of QuadTree_repulsive_force_interact. Forces between
+     points go to force, forces between cells to cell_force, both laid out as
+     in qt */
+  const flat_cell *q1 = &qt->cells[c1], *q2 = &qt->cells[c2];
+  double *x1, *x2, *f1, *f2, dist, f, w;
+  int dim = qt->dim, n = qt->n, i, j, j1, j2, k;
+
+  switch (flat_pair_step(qt, c1, c2, bh, &dist)){
+  case FLAT_FAR:
+    /* far enough, calculate repulsive force */
+    counts[0]++;
+    x1 = &qt->average[c1*dim];
+    x2 = &qt->average[c2*dim];
+    w = (double)q1->n*q2->n*KP;
+    f1 = &cell_force[c1*dim];
+    f2 = &cell_force[c2*dim];
+    assert(dist > 0);
+    for (k = 0; k < dim; k++){
+      if (p == -1){
+	f = w*(x1[k] - x2[k])/(dist*dist);
+      } else {
+	f = w*(x1[k] - x2[k])/pow(dist, 1.- p);
+      }
+      f1[k] += f;
+      f2[k] -= f;
+    }
+    break;
+
+  case FLAT_LEAVES:
+    /* both at leaves, calculate repulsive force between their points */
+    for (j1 = q1->first_point; j1 < q1->first_point + q1->n; j1++){
+      for (j2 = c1 == c2 ? j1 + 1 : q2->first_point; j2 < q2->first_point + q2->n; j2++){
+	counts[1]++;
+	dist = 0;
+	for (k = 0; k < dim; k++){
+	  dist += (qt->coord[k*n+j1] - qt->coord[k*n+j2])*(qt->coord[k*n+j1] - qt->coord[k*n+j2]);
+	}
+	dist = fmax(sqrt(dist), MINDIST);
+	for (k = 0; k < dim; k++){
+	  if (p == -1){
+	    f = KP*(qt->coord[k*n+j1] - qt->coord[k*n+j2])/(dist*dist);
+	  } else {
+	    f = KP*(qt->coord[k*n+j1] - qt->coord[k*n+j2])/pow(dist, 1.- p);
+	  }
+	  force[k*n+j1] += f;
+	  force[k*n+j2] -= f;
+	}
+      }
+    }
+    break;
+
+  case FLAT_SPLIT_BOTH:
+    for (i = q1->first_child; i < q1->first_child + q1->n_children; i++){
+      for (j = i; j < q1->first_child + q1->n_children; j++){
+	FlatQuadTree_repulsive_force_interact(qt, i, j, bh, p, KP, force, cell_force, counts);
+      }
+    }
+    break;
+
+  case FLAT_SPLIT_FIRST:
+    for (i = q1->first_child; i < q1->first_child + q1->n_children; i++){
+      FlatQuadTree_repulsive_force_interact(qt, i, c2, bh, p, KP, force, cell_force, counts);
+    }
+    break;
+
+  case FLAT_SPLIT_SECOND:
+    for (i = q2->first_child; i < q2->first_child + q2->n_children; i++){
+      FlatQuadTree_repulsive_force_interact(qt, i, c1, bh, p, KP, force, cell_force, counts);
+    }
+    break;
+  }
+}
+
+#ifdef _OPENMP
+/* append a pair to qt->next_tasks */
+static void flat_task_push(FlatQuadTree qt, int *n_next, int c1, int c2){
+  if (*n_next == qt->tasks_cap){
+    int cap = MAX(2*qt->tasks_cap, FLAT_TASKS_MIN);
+    qt->tasks = gv_recalloc(qt->tasks, qt->tasks_cap, cap, sizeof(cell_pair));
+    qt->next_tasks = gv_recalloc(qt->next_tasks, qt->tasks_cap, cap, sizeof(cell_pair));
+    qt->tasks_cap = cap;
+  }
+  qt->next_tasks[(*n_next)++] = (cell_pair){c1, c2};
+}
+
+/* Split the traversal from the root into at least FLAT_TASKS_MIN pairs of
+   cells, if there are that many, by taking the steps the traversal would take.
+   Returns the number of pairs, left in qt->tasks. The split depends only on
+   the tree. */
+static int flat_tasks(FlatQuadTree qt, double bh){
+  int n_tasks = 1, n_next, t, i, j, c1, c2;
+  const flat_cell *q1, *q2;
+  double dist;
+  cell_pair *swap;
+  bool split = true;
+
+  n_next = 0;
+  flat_task_push(qt, &n_next, 0, 0);
+  swap = qt->tasks; qt->tasks = qt->next_tasks; qt->next_tasks = swap;
+
+  while (split && n_tasks < FLAT_TASKS_MIN){
+    split = false;
+    n_next = 0;
+    for (t = 0; t < n_tasks; t++){
+      c1 = qt->tasks[t].c1;
+      c2 = qt->tasks[t].c2;
+      q1 = &qt->cells[c1];
+      q2 = &qt->cells[c2];
+      switch (flat_pair_step(qt, c1, c2, bh, &dist)){
+      case FLAT_FAR:
+      case FLAT_LEAVES:
+	flat_task_push(qt, &n_next, c1, c2);
+	break;
+      case FLAT_SPLIT_BOTH:
+	for (i = q1->first_child; i < q1->first_child + q1->n_children; i++){
+	  for (j = i; j < q1->first_child + q1->n_children; j++) flat_task_push(qt, &n_next, i, j);
+	}
+	split = true;
+	break;
+      case FLAT_SPLIT_FIRST:
+	for (i = q1->first_child; i < q1->first_child + q1->n_children; i++) flat_task_push(qt, &n_next, i, c2);
+	split = true;
+	break;
+      case FLAT_SPLIT_SECOND:
+	for (i = q2->first_child; i < q2->first_child + q2->n_children; i++) flat_task_push(qt, &n_next, i, c1);
+	split = true;
+	break;
+      }
+    }
+    /* flat_task_push may have grown both arrays */
+    swap = qt->tasks; qt->tasks = qt->next_tasks; qt->next_tasks = swap;
+    n_tasks = n_next;
+  }
+  return n_tasks;
+}
+
+/* run the traversal in FLAT_BLOCKS blocks and sum their forces into qt */
+static void flat_blocks_interact(FlatQuadTree qt, double bh, double p, double KP, double *counts){
+  int n = qt->n, dim = qt->dim, n_cells = qt->n_cells, n_tasks, i;
+  double block_counts[FLAT_BLOCKS][4] = {{0}};
+
+  n_tasks = flat_tasks(qt, bh);
+
+  if (n > qt->block_points_cap){
+    qt->block_force = gv_recalloc(qt->block_force, (size_t)(FLAT_BLOCKS - 1)*dim*qt->block_points_cap,
+				  (size_t)(FLAT_BLOCKS - 1)*dim*n, sizeof(double));
+    qt->block_points_cap = n;
+  }
+  if (n_cells > qt->block_cells_cap){
+    qt->block_cell_force = gv_recalloc(qt->block_cell_force, (size_t)(FLAT_BLOCKS - 1)*dim*qt->block_cells_cap,
+				       (size_t)(FLAT_BLOCKS - 1)*dim*n_cells, sizeof(double));
+    qt->block_cells_cap = n_cells;
+  }
+
+  /* block 0 accumulates into qt itself */
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int b = 0; b < FLAT_BLOCKS; b++){
+    double *force = b == 0 ? qt->force : &qt->block_force[(size_t)(b - 1)*dim*n];
+    double *cell_force = b == 0 ? qt->cell_force : &qt->block_cell_force[(size_t)(b - 1)*dim*n_cells];
+    for (int k = 0; k < dim*n; k++) force[k] = 0;
+    for (int k = 0; k < dim*n_cells; k++) cell_force[k] = 0;
+    for (int t = b; t < n_tasks; t += FLAT_BLOCKS){
+      FlatQuadTree_repulsive_force_interact(qt, qt->tasks[t].c1, qt->tasks[t].c2, bh, p, KP,
+					    force, cell_force, block_counts[b]);
+    }
+  }
+
+  /* add the other blocks in a fixed order */
+#pragma omp parallel for
+  for (i = 0; i < dim*n; i++){
+    for (int b = 1; b < FLAT_BLOCKS; b++) qt->force[i] += qt->block_force[(size_t)(b - 1)*dim*n + i];
+  }
+#pragma omp parallel for
+  for (i = 0; i < dim*n_cells; i++){
+    for (int b = 1; b < FLAT_BLOCKS; b++) qt->cell_force[i] += qt->block_cell_force[(size_t)(b - 1)*dim*n_cells + i];
+  }
+  for (int b = 0; b < FLAT_BLOCKS; b++){
+    for (i = 0; i < 4; i++) counts[i] += block_counts[b][i];
+  }
+}
+#endif
+
+void FlatQuadTree_get_repulsive_force(FlatQuadTree qt, double *force, double bh, double p, double KP, double *counts){
+  int n = qt->n, dim = qt->dim, c, child, i, j, k;
+  const flat_cell *cell;
+  double wgt;
+
+  for (i = 0; i < 4; i++) counts[i] = 0;
+#ifdef _OPENMP
+  if (n >= FLAT_PARALLEL_MIN){
+    flat_blocks_interact(qt, bh, p, KP, counts);
+  } else
+#endif
+  {
+    for (i = 0; i < dim*qt->n_cells; i++) qt->cell_force[i] = 0;
+    for (i = 0; i < dim*n; i++) qt->force[i] = 0;
+    FlatQuadTree_repulsive_force_interact(qt, 0, 0, bh, p, KP, qt->force, qt->cell_force, counts);
+  }
+
+  /* push down forces on cells to the points. Children come after their parent,
+     so one pass in cell order does this. */
+  for (c = 0; c < qt->n_cells; c++){
+    cell = &qt->cells[c];
+    counts[2]++;
+    if (cell->first_child < 0){
+      for (j = cell->first_point; j < cell->first_point + cell->n; j++){
+	for (k = 0; k < dim; k++) qt->force[k*n+j] += qt->cell_force[c*dim+k]/cell->n;
+      }
+      continue;
+    }
+    for (child = cell->first_child; child < cell->first_child + cell->n_children; child++){
+      wgt = (double)qt->cells[child].n/cell->n;
+      for (k = 0; k < dim; k++) qt->cell_force[child*dim+k] += wgt*qt->cell_force[c*dim+k];
+    }
+  }
+
+  for (j = 0; j < n; j++){
+    for (k = 0; k < dim; k++) force[qt->order[j].id*dim+k] = qt->force[k*n+j];
+  }
+  for (i = 0; i < 4; i++) counts[i] /= n;
+}
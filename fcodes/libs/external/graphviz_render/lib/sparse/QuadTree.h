@@ -55,6 +55,27 @@ void QuadTree_get_supernodes(QuadTree qt, double bh, double *pt, int nodeid, int
 
 void QuadTree_get_repulsive_force(QuadTree qt, double *force, double *x, double bh, double p, double KP, double *counts);
 
+/* A quadtree over points of unit weight, stored in flat arrays for the
+   repulsive force computation of sfdp. Points are sorted by their Morton code
+   so the points of a cell are contiguous, their coordinates are stored one
+   dimension at a time, and the children of a cell are consecutive in the cell
+   array. Building is a sort plus one pass, and the arrays are kept between
+   builds, so a tree rebuilt on every iteration of a layout allocates only when
+   the graph grows. */
+typedef struct FlatQuadTree_struct *FlatQuadTree;
+
+FlatQuadTree FlatQuadTree_new(int dim);
+
+void FlatQuadTree_delete(FlatQuadTree qt);
+
+/* (re)build the tree over the n points of coord, point i at [i*dim, i*dim+dim-1].
+   Cells holding more than one point are subdivided down to level max_level,
+   as in QuadTree_new_from_point_list. */
+void FlatQuadTree_build(FlatQuadTree qt, int n, int max_level, double *coord);
+
+/* same as QuadTree_get_repulsive_force, for the points of the last build */
+void FlatQuadTree_get_repulsive_force(FlatQuadTree qt, double *force, double bh, double p, double KP, double *counts);
+
 /* find the nearest point and put in ymin, index in imin and distance in min */
 void QuadTree_get_nearest(QuadTree qt, double *x, double *ymin, int *imin, double *min);
 
@@ -304,7 +304,7 @@ static gvrender_engine_t gdiplusgen_engine = {
 };
 
 static gvrender_features_t render_features_gdiplus = {
-	GVRENDER_Y_GOES_DOWN | GVRENDER_DOES_TRANSFORM, /* flags */
+	GVRENDER_Y_GOES_DOWN | GVRENDER_DOES_TRANSFORM | GVRENDER_DRAWS_TEXT_LAYOUT, /* flags */
     4.,							/* default pad - graph units */
     nullptr,						/* knowncolors */
     0,							/* sizeof knowncolors */
@@ -27,6 +27,7 @@
 #include <gvc/gvcint.h>
 #include <cgraph/agxbuf.h>
 #include <common/const.h>
+#include <common/render.h>
 #include <common/utils.h>
 #include "../core/ps.h"
 
@@ -333,6 +334,8 @@ static void lasi_textspan(GVJ_t * job, pointf p, textspan_t * span)
     if (job->obj->pencolor.u.HSVA[3] < .5)
 	return;  /* skip transparent text */
 
+    /* spans sized from the text span cache have no layout yet */
+    textspan_layout(job->gvc, span);
     if (span->layout) {
 	pango_font = pango_layout_get_font_description((PangoLayout*)(span->layout));
 	font = pango_font_description_get_family(pango_font);
@@ -390,15 +393,15 @@ static void lasi_textspan(GVJ_t * job, pointf p, textspan_t * span)
     }
     else {
 	pA = span->font->postscript_alias;
-	font = pA->svg_font_family;
+	font = pA ? pA->svg_font_family : span->font->name;
 	stretch = NORMAL_STRETCH;
-	if (pA->svg_font_style
+	if (pA && pA->svg_font_style
 	&& strcmp(pA->svg_font_style, "italic") == 0)
 	    style = ITALIC;
 	else
 	    style = NORMAL_STYLE;
 	variant = NORMAL_VARIANT;
-	if (pA->svg_font_weight
+	if (pA && pA->svg_font_weight
 	&& strcmp(pA->svg_font_weight, "bold") == 0)
 	    weight = BOLD;
 	else
@@ -590,7 +593,8 @@ static gvrender_features_t render_features_lasi = {
     GVRENDER_DOES_TRANSFORM
 	| GVRENDER_DOES_MAPS
 	| GVRENDER_NO_WHITE_BG
-	| GVRENDER_DOES_MAP_RECTANGLE,
+	| GVRENDER_DOES_MAP_RECTANGLE
+	| GVRENDER_DRAWS_TEXT_LAYOUT,
     4.,                         /* default pad - graph units */
     NULL,			/* knowncolors */
     0,				/* sizeof knowncolors */
@@ -1 +1,9 @@
+#pragma once
+
+#include <common/textspan.h>
+#include <stdbool.h>
+
 #define FONT_DPI 96.
+
+/// measure a text span and make the pango layout that draws it
+bool pango_textlayout(textspan_t *span, char **fontpath);
@@ -258,6 +258,17 @@ static void cairogen_textspan(GVJ_t * job, pointf p, textspan_t * span)
     cairo_t *cr = job->context;
     pointf A[2];
 
+    /* spans sized from the text span cache have no layout yet. Make one
+     * without disturbing the size and offsets the caller placed it with. */
+    if (!span->layout) {
+	textspan_t measured = *span;
+	pango_textlayout(&measured, NULL);
+	span->layout = measured.layout;
+	span->free_layout = measured.free_layout;
+    }
+    if (!span->layout)
+	return;
+
     cairo_set_dash (cr, dashed, 0, 0.0);  /* clear any dashing */
     cairogen_set_color(cr, &obj->pencolor);
 
@@ -476,7 +487,8 @@ static gvrender_engine_t cairogen_engine = {
 
 static gvrender_features_t render_features_cairo = {
     GVRENDER_Y_GOES_DOWN
-	| GVRENDER_DOES_TRANSFORM, /* flags */
+	| GVRENDER_DOES_TRANSFORM
+	| GVRENDER_DRAWS_TEXT_LAYOUT, /* flags */
     4.,                         /* default pad - graph units */
     0,				/* knowncolors */
     0,				/* sizeof knowncolors */
@@ -471,7 +471,7 @@ static gvrender_engine_t quartzgen_engine = {
 };
 
 static gvrender_features_t render_features_quartz = {
-    GVRENDER_DOES_MAPS | GVRENDER_DOES_MAP_RECTANGLE | GVRENDER_DOES_TRANSFORM,	/* flags */
+    GVRENDER_DOES_MAPS | GVRENDER_DOES_MAP_RECTANGLE | GVRENDER_DOES_TRANSFORM | GVRENDER_DRAWS_TEXT_LAYOUT,	/* flags */
     4.,				/* default pad - graph units */
     NULL,			/* knowncolors */
     0,				/* sizeof knowncolors */
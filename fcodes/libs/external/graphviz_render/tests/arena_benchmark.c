@@ -0,0 +1,116 @@
+/* worker of arena_benchmark.py: read, lay out and free a graph a number of
+ * times, with or without arena storage, and report
+ *
+ *   <allocations> <peak RSS KiB> <parse s> <layout s> <free s>
+ *
+ * where times are the minimum over the repetitions and allocations are those
+ * of the last repetition. An engine of "none" skips the layout, measuring only
+ * how the graph is stored.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <graphviz/gvc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+static size_t allocations;
+
+#ifdef __GLIBC__
+// count calls into the allocator by interposing on glibc's
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+  ++allocations;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  ++allocations;
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  ++allocations;
+  return __libc_realloc(ptr, size);
+}
+#endif
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static double fmin_(double a, double b) { return a < b ? a : b; }
+
+int main(int argc, char **argv) {
+  if (argc != 5) {
+    fprintf(stderr, "usage: %s arena|malloc <engine> <repeat> <graph>\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+  agreadarena(strcmp(argv[1], "arena") == 0);
+  const char *engine = strcmp(argv[2], "none") == 0 ? NULL : argv[2];
+  const int repeat = atoi(argv[3]);
+
+  GVC_t *gvc = gvContext();
+  assert(gvc != NULL);
+
+  double parse = 1e9, layout = 1e9, release = 1e9;
+  size_t allocs = 0;
+  for (int i = 0; i < repeat; ++i) {
+    FILE *f = fopen(argv[4], "r");
+    if (f == NULL) {
+      fprintf(stderr, "could not open %s\n", argv[4]);
+      return EXIT_FAILURE;
+    }
+
+    const size_t before = allocations;
+    const double t0 = now();
+    Agraph_t *g = agread(f, NULL);
+    const double t1 = now();
+    fclose(f);
+    if (g == NULL) {
+      fprintf(stderr, "could not read %s\n", argv[4]);
+      return EXIT_FAILURE;
+    }
+    const double t2 = now();
+    if (engine != NULL)
+      gvLayout(gvc, g, engine);
+    const double t3 = now();
+    if (engine != NULL)
+      gvFreeLayout(gvc, g);
+    agclose(g);
+    const double t4 = now();
+
+    allocs = allocations - before;
+    parse = fmin_(parse, t1 - t0);
+    layout = fmin_(layout, t3 - t2);
+    release = fmin_(release, t4 - t3);
+  }
+  gvFreeContext(gvc);
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  long rss = usage.ru_maxrss;
+#ifdef __APPLE__
+  rss /= 1024; // macOS reports bytes
+#endif
+
+#ifdef __GLIBC__
+  printf("%zu", allocs);
+#else
+  (void)allocs;
+  printf("-");
+#endif
+  printf(" %ld %f %f %f\n", rss, parse, layout, release);
+  return EXIT_SUCCESS;
+}
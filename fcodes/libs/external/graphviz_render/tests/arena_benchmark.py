@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+
+"""
+Benchmark of arena storage for graphs
+
+Reads, lays out and frees each graph with the default allocator and with
+`agreadarena(1)`, reporting the number of allocations, the peak resident set
+size and the time spent parsing, laying out and freeing the graph. Every graph
+and mode runs in a process of its own, so peak RSS is not shared between
+them.
+
+By default, the largest graphs among tests/*.dot and tests/regression_tests/large
+are used. Pass paths to benchmark other graphs instead, or --synthetic to add a
+generated graph of the given number of nodes, with two edges and a record label
+per node. `--synthetic 300000 -K none` measures storage alone on a graph too
+large to lay out. The worker, arena_benchmark.c, is compiled against the
+installed Graphviz, so CFLAGS and LDFLAGS may need to point at it.
+"""
+
+import argparse
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+from typing import List, Tuple
+
+HERE = Path(__file__).resolve().parent
+sys.path.append(str(HERE))
+from gvtest import ROOT, compile_c  # pylint: disable=wrong-import-position
+
+MODES = ("malloc", "arena")
+
+
+def default_inputs(largest: int) -> List[Path]:
+    """
+    the graphs to benchmark if none were given
+    """
+    large = ROOT / "tests" / "regression_tests" / "large"
+    candidates = sorted((ROOT / "tests").glob("*.dot")) + sorted(
+        p for p in large.iterdir() if p.is_file() and p.suffix != ".py"
+    )
+    candidates.sort(key=lambda p: p.stat().st_size, reverse=True)
+    return candidates[:largest]
+
+
+def synthetic(nodes: int, dst: Path) -> Path:
+    """
+    write a graph of the given number of nodes, each with a record label and
+    two out edges, to dst
+    """
+    with open(dst, "wt", encoding="utf-8") as f:
+        f.write("digraph synthetic {\n  node [shape=record];\n")
+        for i in range(nodes):
+            f.write(f'  n{i} [label="{{n{i}|{{<in>in|<out>out}}}}"];\n')
+            f.write(f"  n{i}:out -> n{(7 * i + 1) % nodes}:in;\n")
+            f.write(f"  n{i} -> n{(13 * i + 5) % nodes} [weight=2];\n")
+        f.write("}\n")
+    return dst
+
+
+def run(
+    worker: Path, mode: str, engine: str, repeat: int, graph: Path
+) -> Tuple[str, int, float, float, float]:
+    """
+    measure one graph in one mode, returning allocations, peak RSS in KiB and
+    seconds to parse, lay out and free
+    """
+    out = subprocess.check_output(
+        [worker, mode, engine, str(repeat), graph],
+        stderr=subprocess.DEVNULL,
+        universal_newlines=True,
+    )
+    allocs, rss, parse, layout, free = out.split()
+    return allocs, int(rss), float(parse), float(layout), float(free)
+
+
+def main(args: List[str]) -> int:
+    """
+    entry point
+    """
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("--repeat", type=int, default=3, help="runs per graph")
+    parser.add_argument(
+        "--largest", type=int, default=10, help="number of test graphs by default"
+    )
+    parser.add_argument(
+        "--synthetic", type=int, default=0, help="nodes of a generated graph to add"
+    )
+    parser.add_argument(
+        "-K", dest="engine", default="dot", help="layout engine, or none"
+    )
+    parser.add_argument("graphs", nargs="*", type=Path, help="graphs to lay out")
+    options = parser.parse_args(args[1:])
+
+    with tempfile.TemporaryDirectory() as tmp:
+        worker = compile_c(
+            HERE / "arena_benchmark.c",
+            link=["cgraph", "gvc"],
+            dst=Path(tmp) / "arena_benchmark.exe",
+        )
+
+        graphs = options.graphs or default_inputs(options.largest)
+        if options.synthetic > 0:
+            graphs.append(
+                synthetic(options.synthetic, Path(tmp) / "synthetic.gv")
+            )
+        if not graphs:
+            sys.stderr.write("no graphs to benchmark\n")
+            return 1
+        print(
+            f"{'graph':24} {'mode':6} {'allocs':>9} {'RSS KiB':>8} "
+            f"{'parse s':>8} {'layout s':>8} {'free s':>8} {'total s':>8}"
+        )
+        for graph in graphs:
+            for mode in MODES:
+                try:
+                    allocs, rss, parse, layout, free = run(
+                        worker, mode, options.engine, options.repeat, graph
+                    )
+                except subprocess.CalledProcessError:
+                    print(f"{graph.name[:24]:24} {mode:6} failed")
+                    continue
+                total = parse + layout + free
+                print(
+                    f"{graph.name[:24]:24} {mode:6} {allocs:>9} {rss:8} "
+                    f"{parse:8.4f} {layout:8.4f} {free:8.4f} {total:8.4f}"
+                )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,83 @@
+// see test_misc.py:test_arena_close
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stddef.h>
+
+static size_t deleted;
+
+static void on_delete(Agraph_t *g, Agobj_t *obj, void *arg) {
+  (void)g;
+  (void)obj;
+  (void)arg;
+  ++deleted;
+}
+
+static Agcbdisc_t callbacks = {
+    .graph = {.del = on_delete},
+    .node = {.del = on_delete},
+    .edge = {.del = on_delete},
+};
+
+static Agdesc_t arena_desc(void) {
+  Agdesc_t desc = Agdirected;
+  desc.arena = 1;
+  return desc;
+}
+
+/// give `g` anonymous subgraphs and nodes, so it has internal name maps
+static void populate(Agraph_t *g) {
+  Agraph_t *s = agsubg(g, "%1", 1);
+  assert(s != NULL);
+  Agnode_t *a = agnode(s, "a", 1);
+  assert(a != NULL);
+  Agnode_t *b = agnode(g, "%2", 1);
+  assert(b != NULL);
+  Agedge_t *e = agedge(g, a, b, NULL, 1);
+  assert(e != NULL);
+}
+
+int main(void) {
+
+  // closing a subgraph of an arena graph deletes its objects one by one
+  {
+    Agraph_t *g = agopen("g", arena_desc(), NULL);
+    assert(g != NULL);
+    Agraph_t *s = agsubg(g, "%1", 1);
+    assert(s != NULL);
+    Agnode_t *a = agnode(s, "a", 1);
+    assert(a != NULL);
+    int r = agclose(s);
+    assert(r == 0);
+
+    // the graph should still be usable afterwards
+    populate(g);
+    r = agclose(g);
+    assert(r == 0);
+  }
+
+  // callbacks make the root close object by object too
+  {
+    Agraph_t *g = agopen("g", arena_desc(), NULL);
+    assert(g != NULL);
+    agpushdisc(g, &callbacks, NULL);
+    populate(g);
+    deleted = 0;
+    int r = agclose(g);
+    assert(r == 0);
+    assert(deleted > 0);
+  }
+
+  // as does an ID discipline other than the default
+  {
+    Agiddisc_t ids = AgIdDisc;
+    Agdisc_t disc = {.id = &ids, .io = &AgIoDisc};
+    Agraph_t *g = agopen("g", arena_desc(), &disc);
+    assert(g != NULL);
+    populate(g);
+    int r = agclose(g);
+    assert(r == 0);
+  }
+
+  return 0;
+}
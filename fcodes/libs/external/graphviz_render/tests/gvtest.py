@@ -22,7 +22,7 @@ def compile_c(
     link: List[str] = None,
     dst: Optional[Union[Path, str]] = None,
 ) -> Path:
-    """compile a C program"""
+    """compile a C program, or a C++ one if `src` is a .cpp file"""
 
     if cflags is None:
         cflags = []
@@ -47,9 +47,14 @@ def compile_c(
             args += ["-link"] + [f"{l}.lib" for l in link] + ldflags
 
     else:
-        # construct an invocation of the default C compiler
-        cc = os.environ.get("CC", "cc")
-        args = [cc, "-std=c99", src, "-o", dst] + cflags
+        # construct an invocation of the default C or C++ compiler
+        if Path(src).suffix == ".cpp":
+            cc = os.environ.get("CXX", "c++")
+            std = "-std=c++17"
+        else:
+            cc = os.environ.get("CC", "cc")
+            std = "-std=c99"
+        args = [cc, std, src, "-o", dst] + cflags
         if len(link) > 0:
             args += [f"-l{l}" for l in link] + ldflags
 
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+
+"""
+Benchmark of incremental dot layout against a full layout
+
+Lays out generated layered graphs, makes a small edit to each (a new node and
+an edge to it), and then lays out the edited graph both afresh and with
+`incremental=true` starting from the first layout. For each it reports the
+seconds spent in dot's ranking, crossing minimization, positioning and spline
+routing, as measured by `--profile`, and the crossings found.
+
+Only ranking and crossing minimization start warm, so the per-edit cost stays
+proportional to the size of the whole graph. This benchmark is there to show how
+much of it is saved.
+"""
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+from typing import Dict, List
+
+# phases of dot reported, in the order they run
+PHASES = ("dot_rank", "dot_mincross", "dot_position", "dot_splines")
+
+
+def layered(nodes: int, seed: int) -> List[str]:
+    """
+    the edges of a random layered graph with about two edges per node
+    """
+    rng = random.Random(seed)
+    width = max(4, int(nodes**0.5))
+    edges = []
+    for n in range(width, nodes):
+        for _ in range(2):
+            src = n - width // 2 - rng.randrange(width)
+            if src >= 0:
+                edges.append(f"n{src} -> n{n};")
+    return edges
+
+
+def phases(profile: Path) -> Dict[str, float]:
+    """
+    seconds per phase and crossings of the last graph in a profile
+    """
+    with open(profile, "rt", encoding="utf-8") as f:
+        record = json.loads(f.read().splitlines()[-1])
+    result = {p: 0.0 for p in PHASES}
+
+    def visit(spans):
+        for span in spans:
+            if span["name"] in result:
+                result[span["name"]] += span["seconds"]
+            visit(span["children"])
+
+    visit(record["spans"])
+    result["crossings"] = record["counters"].get("mincross_crossings", 0)
+    return result
+
+
+def run(source: str, tmp: Path) -> Dict[str, float]:
+    """
+    lay out a graph once, returning its profile
+    """
+    profile = tmp / "profile.jsonl"
+    if profile.exists():
+        profile.unlink()
+    subprocess.run(
+        ["dot", "-Tdot", "-o", os.devnull, f"--profile={profile}"],
+        input=source,
+        universal_newlines=True,
+        check=True,
+    )
+    return phases(profile)
+
+
+def fastest(source: str, tmp: Path, repeat: int) -> Dict[str, float]:
+    """
+    the minimum of each phase over a number of layouts
+    """
+    runs = [run(source, tmp) for _ in range(repeat)]
+    return {k: min(r[k] for r in runs) for k in runs[0]}
+
+
+def main(args: List[str]) -> int:
+    """
+    entry point
+    """
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("--repeat", type=int, default=3, help="runs per layout")
+    parser.add_argument(
+        "--sizes",
+        type=int,
+        nargs="+",
+        default=[500, 2000, 8000],
+        help="nodes of the generated graphs",
+    )
+    options = parser.parse_args(args[1:])
+
+    print(
+        f"{'nodes':>6} {'mode':12} "
+        + " ".join(f"{p[4:]:>9}" for p in PHASES)
+        + f" {'total s':>8} {'crossings':>9}"
+    )
+    with tempfile.TemporaryDirectory() as tmp:
+        for nodes in options.sizes:
+            edges = layered(nodes, nodes)
+            before = "digraph { " + " ".join(edges) + " }"
+            laid_out = subprocess.check_output(
+                ["dot", "-Tdot"], input=before, universal_newlines=True
+            )
+
+            # the edit: a new node hanging off the middle of the graph
+            edit = f"n{nodes // 2} -> extra;"
+            fresh = before[:-1] + f"{edit} }}"
+            warm = laid_out.rstrip()[:-1] + f" incremental=true; {edit} }}"
+
+            for mode, source in (("fresh", fresh), ("incremental", warm)):
+                r = fastest(source, Path(tmp), options.repeat)
+                total = sum(r[p] for p in PHASES)
+                print(
+                    f"{nodes:6} {mode:12} "
+                    + " ".join(f"{r[p]:9.4f}" for p in PHASES)
+                    + f" {total:8.4f} {int(r['crossings']):9}"
+                )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
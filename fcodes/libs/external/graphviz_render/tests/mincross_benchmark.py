@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+
+"""
+Micro-benchmark of crossing minimization in dot
+
+Runs dot over a set of graphs and reports the time spent in crossing
+minimization, as measured by `--profile` on a monotonic clock, along with the
+number of crossings found. The crossing counts double as a determinism check:
+every repetition must find the same number.
+
+By default, the larger .dot files in this directory and in
+regression_tests/large are used, together with generated graphs that have wide
+sibling groups and long edges. Pass paths to benchmark other graphs instead.
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+from typing import Dict, List, Tuple
+
+HERE = Path(__file__).resolve().parent
+
+# profiled span of crossing minimization
+MINCROSS = "dot_mincross"
+
+
+def family_tree(generations: int, children: int) -> str:
+    """
+    a graph with wide sibling groups where every generation also links back to
+    its grandparents, giving many virtual node chains
+    """
+    lines = ["digraph family {"]
+    level = ["p0"]
+    prev_level: List[str] = []
+    for g in range(generations):
+        nxt = []
+        for i, parent in enumerate(level):
+            for c in range(children if g < 2 else 2):
+                child = f"g{g}_{i}_{c}"
+                nxt.append(child)
+                lines.append(f"  {parent} -> {child};")
+                if prev_level:
+                    lines.append(f"  {prev_level[i % len(prev_level)]} -> {child};")
+        prev_level, level = level, nxt
+    lines.append("}")
+    return "\n".join(lines)
+
+
+def default_inputs(tmp: Path, largest: int) -> List[Path]:
+    """
+    the graphs to benchmark if none were given
+    """
+    candidates = sorted(HERE.glob("*.dot")) + sorted(
+        (HERE / "regression_tests" / "large").glob("*")
+    )
+    candidates = [c for c in candidates if c.is_file() and c.suffix != ".py"]
+    candidates.sort(key=lambda p: p.stat().st_size, reverse=True)
+    inputs = candidates[:largest]
+
+    for generations, children in ((4, 12), (5, 20)):
+        path = tmp / f"family_{generations}x{children}.dot"
+        path.write_text(family_tree(generations, children), encoding="utf-8")
+        inputs.append(path)
+    return inputs
+
+
+def seconds(spans: List[dict], name: str) -> float:
+    """
+    total seconds of the spans of the given name in a profile tree
+    """
+    total = 0.0
+    for span in spans:
+        if span["name"] == name:
+            total += span["seconds"]
+        total += seconds(span["children"], name)
+    return total
+
+
+def run(graph: Path, tmp: Path) -> Dict[str, Tuple[int, float]]:
+    """
+    lay out a graph once, returning crossings and seconds per graph name
+    """
+    profile = tmp / "profile.jsonl"
+    if profile.exists():
+        profile.unlink()
+    subprocess.run(
+        ["dot", f"--profile={profile}", "-Tcanon", "-o", os.devnull, graph],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+        check=False,
+    )
+    results = {}
+    if not profile.exists():
+        return results
+    with open(profile, "rt", encoding="utf-8") as f:
+        for line in f:
+            record = json.loads(line)
+            crossings = int(record["counters"].get("mincross_crossings", 0))
+            results[record["graph"]] = (
+                crossings,
+                seconds(record["spans"], MINCROSS),
+            )
+    return results
+
+
+def main(args: List[str]) -> int:
+    """
+    entry point
+    """
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("--repeat", type=int, default=5, help="runs per graph")
+    parser.add_argument(
+        "--largest", type=int, default=10, help="number of test graphs by default"
+    )
+    parser.add_argument("graphs", nargs="*", type=Path, help="graphs to lay out")
+    options = parser.parse_args(args[1:])
+
+    status = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        graphs = options.graphs or default_inputs(Path(tmp), options.largest)
+        print(f"{'graph':40} {'crossings':>10} {'min s':>9} {'median s':>9}")
+        for graph in graphs:
+            runs = [run(graph, Path(tmp)) for _ in range(options.repeat)]
+            for name in runs[0]:
+                crossings = {r[name][0] for r in runs if name in r}
+                times = [r[name][1] for r in runs if name in r]
+                label = f"{graph.name}:{name}"[:40]
+                nc = "/".join(str(c) for c in sorted(crossings))
+                print(
+                    f"{label:40} {nc:>10} {min(times):9.5f} "
+                    f"{statistics.median(times):9.5f}"
+                )
+                if len(crossings) > 1:
+                    print(f"  nondeterministic crossing count for {label}")
+                    status = 1
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
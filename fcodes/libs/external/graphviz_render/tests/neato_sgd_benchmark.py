@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+
+"""
+Benchmark of neato's exact and sparse stochastic gradient descent modes
+
+Lays out graphs with `neato -Gmode=sgd` and `neato -Gmode=sparse_sgd` and
+reports, for each mode, the wall clock time, the peak memory use of neato and
+the stress of the resulting layout. Stress is measured against graph theoretic
+distances with unit edge lengths, normalized by the number of node pairs, over
+a sample of source nodes for larger graphs, so it is comparable between the
+two modes and across graph sizes.
+
+By default, generated grids and random sparse graphs of increasing size are
+used. Pass paths to benchmark other graphs instead. The exact mode is skipped
+for graphs larger than --exact-limit nodes, as its memory use is quadratic.
+"""
+
+import argparse
+import collections
+import math
+import random
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+# modes to compare, the sparse one first to learn the graph size
+MODES = ("sparse_sgd", "sgd")
+
+Layout = Tuple[Dict[str, Tuple[float, float]], Dict[str, List[str]]]
+
+
+def grid(width: int) -> str:
+    """
+    a square grid graph
+    """
+    lines = ["graph grid {", "  node [shape=point];"]
+    for y in range(width):
+        for x in range(width):
+            if x + 1 < width:
+                lines.append(f"  n{x}_{y} -- n{x + 1}_{y};")
+            if y + 1 < width:
+                lines.append(f"  n{x}_{y} -- n{x}_{y + 1};")
+    lines.append("}")
+    return "\n".join(lines)
+
+
+def random_sparse(n: int, extra: float, seed: int) -> str:
+    """
+    a connected random graph, a random tree plus `extra * n` further edges
+    """
+    rng = random.Random(seed)
+    lines = ["graph random {", "  node [shape=point];"]
+    for i in range(1, n):
+        lines.append(f"  n{rng.randrange(i)} -- n{i};")
+    for _ in range(int(extra * n)):
+        lines.append(f"  n{rng.randrange(n)} -- n{rng.randrange(n)};")
+    lines.append("}")
+    return "\n".join(lines)
+
+
+def default_inputs(tmp: Path) -> List[Path]:
+    """
+    the graphs to benchmark if none were given
+    """
+    inputs = []
+    for width in (20, 40, 70, 100):
+        path = tmp / f"grid_{width}x{width}.gv"
+        path.write_text(grid(width), encoding="utf-8")
+        inputs.append(path)
+    for n in (1000, 5000, 20000):
+        path = tmp / f"random_{n}.gv"
+        path.write_text(random_sparse(n, 0.5, n), encoding="utf-8")
+        inputs.append(path)
+    return inputs
+
+
+def run(graph: Path, mode: str) -> Tuple[float, int, Layout]:
+    """
+    lay out a graph, returning seconds, peak KiB, node positions and adjacency
+    """
+    # measure memory in a child of our own, so each run gets a fresh peak
+    measure = (
+        "import resource, subprocess, sys;"
+        "p = subprocess.run(sys.argv[1:], stdout=subprocess.PIPE, check=True);"
+        "sys.stdout.buffer.write(p.stdout);"
+        "sys.stderr.write(str(resource.getrusage("
+        "resource.RUSAGE_CHILDREN).ru_maxrss))"
+    )
+    start = time.monotonic()
+    proc = subprocess.run(
+        [sys.executable, "-c", measure, "neato", f"-Gmode={mode}", "-Tplain", graph],
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        universal_newlines=True,
+        check=True,
+    )
+    secs = time.monotonic() - start
+    peak = int(proc.stderr.strip().splitlines()[-1])
+
+    positions = {}
+    adjacency: Dict[str, List[str]] = collections.defaultdict(list)
+    for line in proc.stdout.splitlines():
+        fields = line.split()
+        if fields and fields[0] == "node":
+            positions[fields[1]] = (float(fields[2]), float(fields[3]))
+        elif fields and fields[0] == "edge" and fields[1] != fields[2]:
+            adjacency[fields[1]].append(fields[2])
+            adjacency[fields[2]].append(fields[1])
+    return secs, peak, (positions, adjacency)
+
+
+def stress(layout: Layout, sources: int) -> Optional[float]:
+    """
+    normalized stress of a layout, sum of ((|xi - xj| - dij) / dij)² over pairs
+    """
+    positions, adjacency = layout
+    nodes = sorted(positions)
+    if len(nodes) < 2:
+        return None
+    sample = nodes if len(nodes) <= sources else random.Random(0).sample(nodes, sources)
+    total = 0.0
+    pairs = 0
+    for s in sample:
+        dist = {s: 0}
+        queue = collections.deque([s])
+        while queue:
+            u = queue.popleft()
+            for v in adjacency.get(u, ()):
+                if v not in dist:
+                    dist[v] = dist[u] + 1
+                    queue.append(v)
+        sx, sy = positions[s]
+        for t, d in dist.items():
+            if t == s or t not in positions:
+                continue
+            tx, ty = positions[t]
+            total += ((math.hypot(sx - tx, sy - ty) - d) / d) ** 2
+            pairs += 1
+    return total / pairs if pairs else None
+
+
+def main(args: List[str]) -> int:
+    """
+    entry point
+    """
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument(
+        "--exact-limit",
+        type=int,
+        default=12000,
+        help="largest graph to lay out with the exact mode",
+    )
+    parser.add_argument(
+        "--sources", type=int, default=300, help="source nodes sampled for stress"
+    )
+    parser.add_argument("graphs", nargs="*", type=Path, help="graphs to lay out")
+    options = parser.parse_args(args[1:])
+
+    with tempfile.TemporaryDirectory() as tmp:
+        graphs = options.graphs or default_inputs(Path(tmp))
+        print(f"{'graph':24} {'mode':10} {'nodes':>7} {'secs':>8} {'MiB':>8} {'stress':>8}")
+        for graph in graphs:
+            nodes = 0
+            for mode in MODES:
+                if mode == "sgd" and nodes > options.exact_limit:
+                    print(f"{graph.name[:24]:24} {mode:10} {nodes:7} skipped")
+                    continue
+                secs, peak, layout = run(graph, mode)
+                nodes = len(layout[0])
+                s = stress(layout, options.sources)
+                shown = "-" if s is None else f"{s:.4f}"
+                print(
+                    f"{graph.name[:24]:24} {mode:10} {nodes:7} "
+                    f"{secs:8.2f} {peak / 1024:8.1f} {shown:>8}"
+                )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,149 @@
+/// \file
+/// \brief compare sfdp's repulsive forces from the flat and pointer quadtrees
+///
+/// Run without arguments, both trees are built over the same points, drawn
+/// from a fixed seed, and asked for the Barnes-Hut repulsive force on every
+/// point. The flat tree sums its contributions in a different order, so forces
+/// are compared relative to their magnitude rather than bit for bit.
+///
+/// The trees are deep enough that every leaf holds one point. Leaves at the
+/// last level may hold several, and there the pointer tree's running average
+/// is slightly off, which the flat tree does not reproduce.
+///
+/// Run as `quadtree_forces <points> <max level> <repeat>`, it instead reports
+///
+///   <pointer tree s> <flat tree s>
+///
+/// the minimum time over the repetitions to build each tree and compute the
+/// forces, as sfdp does on every iteration. This is the worker of
+/// sfdp_benchmark.py.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <math.h>
+#include <sparse/QuadTree.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/// largest tolerated difference, relative to the largest force
+#define TOLERANCE 1e-9
+
+enum { DIM = 2 };
+static const double bh = 0.6, p = -1, KP = 1;
+
+/// a linear congruential generator, so the points are the same everywhere
+static double uniform(uint64_t *state) {
+  *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+  return (double)(*state >> 11) / (double)(UINT64_C(1) << 53);
+}
+
+/// `n` clustered points, so the tree has cells of very different depths
+static double *points(int n, uint64_t seed) {
+  double *x = calloc((size_t)n * DIM, sizeof(double));
+  assert(x != NULL);
+  for (int i = 0; i < n; i++) {
+    const double cx = i % 7, cy = i % 5;
+    x[i * DIM] = cx + uniform(&seed);
+    x[i * DIM + 1] = cy + uniform(&seed) * uniform(&seed);
+  }
+  return x;
+}
+
+/// compare the forces on `n` points, returning non-zero on a mismatch
+static int compare(int n, uint64_t seed) {
+  const int max_level = 20;
+
+  double *x = points(n, seed);
+  double *expected = calloc((size_t)n * DIM, sizeof(double));
+  double *actual = calloc((size_t)n * DIM, sizeof(double));
+  assert(expected != NULL && actual != NULL);
+
+  double counts_old[4] = {0}, counts_new[4] = {0};
+  QuadTree old = QuadTree_new_from_point_list(DIM, n, max_level, x);
+  QuadTree_get_repulsive_force(old, expected, x, bh, p, KP, counts_old);
+  QuadTree_delete(old);
+
+  FlatQuadTree flat = FlatQuadTree_new(DIM);
+  FlatQuadTree_build(flat, n, max_level, x);
+  FlatQuadTree_get_repulsive_force(flat, actual, bh, p, KP, counts_new);
+  FlatQuadTree_delete(flat);
+
+  // both trees should have taken the same steps
+  int failed = 0;
+  for (int i = 0; i < 3; i++) {
+    if (counts_old[i] != counts_new[i]) {
+      printf("%d points: count %d is %g, expected %g\n", n, i, counts_new[i],
+             counts_old[i]);
+      failed = 1;
+    }
+  }
+
+  double largest = 0, worst = 0;
+  for (int i = 0; i < n * DIM; i++) {
+    largest = fmax(largest, fabs(expected[i]));
+    worst = fmax(worst, fabs(expected[i] - actual[i]));
+  }
+
+  if (!(worst <= TOLERANCE * largest)) {
+    failed = 1;
+  }
+  printf("%d points: largest force %g, largest difference %g\n", n, largest,
+         worst);
+
+  free(actual);
+  free(expected);
+  free(x);
+  return failed;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/// time both trees on `n` points
+static void bench(int n, int max_level, int repeat) {
+  double *x = points(n, (uint64_t)n);
+  double *force = calloc((size_t)n * DIM, sizeof(double));
+  assert(force != NULL);
+  double counts[4];
+  double old_secs = INFINITY, flat_secs = INFINITY;
+
+  // the flat tree is kept between builds, as sfdp keeps it between iterations
+  FlatQuadTree flat = FlatQuadTree_new(DIM);
+  for (int r = 0; r < repeat; r++) {
+    double start = now();
+    QuadTree old = QuadTree_new_from_point_list(DIM, n, max_level, x);
+    QuadTree_get_repulsive_force(old, force, x, bh, p, KP, counts);
+    QuadTree_delete(old);
+    old_secs = fmin(old_secs, now() - start);
+
+    start = now();
+    FlatQuadTree_build(flat, n, max_level, x);
+    FlatQuadTree_get_repulsive_force(flat, force, bh, p, KP, counts);
+    flat_secs = fmin(flat_secs, now() - start);
+  }
+  FlatQuadTree_delete(flat);
+
+  printf("%f %f\n", old_secs, flat_secs);
+  free(force);
+  free(x);
+}
+
+int main(int argc, char **argv) {
+  if (argc == 4) {
+    bench(atoi(argv[1]), atoi(argv[2]), atoi(argv[3]));
+    return EXIT_SUCCESS;
+  }
+
+  int failed = 0;
+  // small enough for the serial path, then large enough for the blocked one
+  failed |= compare(100, 1);
+  failed |= compare(1000, 2);
+  failed |= compare(20000, 3);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+// see test_misc.py:test_render_sink
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <graphviz/gvc.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// output collected from a sink
+typedef struct {
+  char *data;
+  size_t length;
+  size_t chunks;
+  size_t refuse_after; ///< refuse chunks after this many, 0 for never
+} collected_t;
+
+static size_t collect(void *context, const char *data, size_t length) {
+  collected_t *c = context;
+  if (c->refuse_after != 0 && c->chunks == c->refuse_after) {
+    ++c->chunks;
+    return 0;
+  }
+  ++c->chunks;
+  c->data = realloc(c->data, c->length + length);
+  assert(c->data != NULL);
+  memcpy(c->data + c->length, data, length);
+  c->length += length;
+  return length;
+}
+
+/// streamed output should match the output rendered to memory
+static bool check_format(GVC_t *gvc, Agraph_t *g, const char *format) {
+  char *expected = NULL;
+  unsigned expected_length = 0;
+  if (gvRenderData(gvc, g, format, &expected, &expected_length) != 0) {
+    printf("%s is not available\n", format);
+    return false;
+  }
+
+  collected_t got = {0};
+  int r = gvRenderSink(gvc, g, format, collect, &got);
+  assert(r == 0);
+  printf("%s: %zu bytes in %zu chunks\n", format, got.length, got.chunks);
+  assert(got.length == expected_length);
+  assert(memcmp(got.data, expected, expected_length) == 0);
+
+  free(got.data);
+  gvFreeRenderData(expected);
+  return true;
+}
+
+int main(void) {
+  GVC_t *gvc = gvContext();
+  assert(gvc != NULL);
+
+  // enough nodes for the SVG to span several chunks
+  Agraph_t *g = agopen("g", Agdirected, NULL);
+  assert(g != NULL);
+  Agnode_t *previous = NULL;
+  for (int i = 0; i < 2000; ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), "node_%d", i);
+    Agnode_t *n = agnode(g, name, 1);
+    if (previous != NULL && i % 10 != 0)
+      (void)agedge(g, previous, n, NULL, 1);
+    previous = n;
+  }
+  int r = gvLayout(gvc, g, "dot");
+  assert(r == 0);
+
+  bool svg = check_format(gvc, g, "svg");
+  assert(svg && "SVG output is always available");
+  (void)check_format(gvc, g, "svgz");
+
+  // a sink that refuses a chunk fails the render and is not called again
+  collected_t refusing = {.refuse_after = 1};
+  r = gvRenderSink(gvc, g, "svg", collect, &refusing);
+  printf("refusing sink: %d after %zu chunks\n", r, refusing.chunks);
+  assert(r != 0);
+  assert(refusing.chunks == 2);
+  free(refusing.data);
+
+  gvFreeLayout(gvc, g);
+  agclose(g);
+  gvFreeContext(gvc);
+  return 0;
+}
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+
+"""
+Benchmark of sfdp's quadtree repulsive forces
+
+First times one build of the tree and one force computation on clustered point
+sets of increasing size, for the pointer-based quadtree and the flat quadtree
+sfdp now uses. The worker, quadtree_forces.c, is compiled from the sources in
+lib/sparse, with OpenMP unless --serial is given.
+
+Then lays out generated random graphs with sfdp, once on a single thread and
+once on all of them, and reports the seconds spent in sfdp's multilevel layout
+and the number of spring-electrical iterations, as measured by `--profile`.
+Passing paths benchmarks those graphs instead of the generated ones.
+"""
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+HERE = Path(__file__).resolve().parent
+sys.path.append(str(HERE))
+from gvtest import ROOT, compile_c  # pylint: disable=wrong-import-position
+
+
+def worker(tmp: Path, serial: bool) -> Path:
+    """
+    compile the force computation worker
+    """
+    (tmp / "config.h").write_text("", encoding="utf-8")
+    sparse = ROOT / "lib/sparse"
+    cflags = ["-O2", "-D_POSIX_C_SOURCE=200809L"]
+    if not serial:
+        cflags += ["-fopenmp"]
+    cflags += ["-I", tmp]
+    for include in ("lib", "lib/common", "lib/cgraph", "lib/cdt"):
+        cflags += ["-I", ROOT / include]
+    cflags += [
+        sparse / "QuadTree.c",
+        sparse / "LinkedList.c",
+        sparse / "general.c",
+        "-lm",
+    ]
+    return compile_c(HERE / "quadtree_forces.c", cflags, dst=tmp / "quadtree_forces.exe")
+
+
+def forces(exe: Path, points: int, max_level: int, repeat: int) -> Tuple[float, float]:
+    """
+    seconds for the pointer tree and the flat tree on a number of points
+    """
+    out = subprocess.check_output(
+        [exe, str(points), str(max_level), str(repeat)], universal_newlines=True
+    )
+    old, flat = out.split()
+    return float(old), float(flat)
+
+
+def random_graph(n: int, seed: int) -> str:
+    """
+    a connected random graph, a random tree plus n/2 further edges
+    """
+    rng = random.Random(seed)
+    lines = ["graph random {", "  node [shape=point];"]
+    for i in range(1, n):
+        lines.append(f"  n{rng.randrange(i)} -- n{i};")
+    for _ in range(n // 2):
+        lines.append(f"  n{rng.randrange(n)} -- n{rng.randrange(n)};")
+    lines.append("}")
+    return "\n".join(lines)
+
+
+def layout(graph: Path, tmp: Path, threads: Optional[int]) -> Tuple[float, int]:
+    """
+    lay out a graph with sfdp, returning seconds in the multilevel layout and
+    iterations
+    """
+    profile = tmp / "profile.jsonl"
+    if profile.exists():
+        profile.unlink()
+    env = dict(os.environ)
+    if threads is not None:
+        env["OMP_NUM_THREADS"] = str(threads)
+    subprocess.run(
+        ["sfdp", "-Tdot", "-o", os.devnull, f"--profile={profile}", graph],
+        env=env,
+        check=True,
+    )
+    with open(profile, "rt", encoding="utf-8") as f:
+        record = json.loads(f.read().splitlines()[-1])
+
+    def seconds(spans: List[Dict]) -> float:
+        total = 0.0
+        for span in spans:
+            if span["name"] == "sfdp_multilevel":
+                total += span["seconds"]
+            else:
+                total += seconds(span["children"])
+        return total
+
+    return seconds(record["spans"]), record["counters"].get("sfdp_iterations", 0)
+
+
+def main(args: List[str]) -> int:
+    """
+    entry point
+    """
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("--repeat", type=int, default=3, help="runs per measurement")
+    parser.add_argument(
+        "--max-level", type=int, default=10, help="depth of the quadtrees"
+    )
+    parser.add_argument(
+        "--serial", action="store_true", help="build the worker without OpenMP"
+    )
+    parser.add_argument("graphs", nargs="*", type=Path, help="graphs to lay out")
+    options = parser.parse_args(args[1:])
+
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = worker(Path(tmp), options.serial)
+        print(f"{'points':>8} {'pointer s':>10} {'flat s':>10} {'speedup':>8}")
+        for points in (1000, 10000, 50000, 200000):
+            old, flat = forces(exe, points, options.max_level, options.repeat)
+            print(f"{points:8} {old:10.4f} {flat:10.4f} {old / flat:8.2f}")
+        print()
+
+        graphs = options.graphs
+        if not graphs:
+            for n in (2000, 10000, 50000):
+                path = Path(tmp) / f"random_{n}.gv"
+                path.write_text(random_graph(n, n), encoding="utf-8")
+                graphs.append(path)
+        print(f"{'graph':24} {'threads':>7} {'layout s':>9} {'iterations':>10}")
+        for graph in graphs:
+            for threads in (1, None):
+                runs = [layout(graph, Path(tmp), threads) for _ in range(options.repeat)]
+                secs = min(r[0] for r in runs)
+                iterations = runs[0][1]
+                shown = "1" if threads == 1 else "all"
+                print(f"{graph.name[:24]:24} {shown:>7} {secs:9.3f} {iterations:10}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
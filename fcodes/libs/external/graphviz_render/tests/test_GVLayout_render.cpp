@@ -1,4 +1,7 @@
 #include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
 #include <catch2/catch.hpp>
 
@@ -37,3 +40,88 @@ TEST_CASE("Rendering in an unknown format throws an exception") {
 
   REQUIRE_THROWS_AS(layout.render("UNKNOWN_FORMAT"), std::runtime_error);
 }
+
+TEST_CASE("Rendered output can be streamed to a writer in chunks") {
+  const auto demand_loading = false;
+  auto gvc =
+      std::make_shared<GVC::GVContext>(lt_preloaded_symbols, demand_loading);
+
+  auto dot = "digraph {a -> b; b -> c; a -> c}";
+  auto g = std::make_shared<CGraph::AGraph>(dot);
+
+  const auto layout = GVC::GVLayout(gvc, g, "dot");
+
+  std::string streamed;
+  layout.render("svg", [&](std::string_view chunk) { streamed += chunk; });
+
+  const auto expected = layout.render("svg");
+  REQUIRE(streamed == expected.string_view());
+}
+
+TEST_CASE("An exception thrown by a writer stops rendering and propagates") {
+  const auto demand_loading = false;
+  auto gvc =
+      std::make_shared<GVC::GVContext>(lt_preloaded_symbols, demand_loading);
+
+  auto dot = "digraph {a -> b}";
+  auto g = std::make_shared<CGraph::AGraph>(dot);
+
+  const auto layout = GVC::GVLayout(gvc, g, "dot");
+
+  auto calls = 0;
+  REQUIRE_THROWS_AS(layout.render("svg",
+                                  [&](std::string_view) {
+                                    ++calls;
+                                    throw std::logic_error("full");
+                                  }),
+                    std::logic_error);
+  REQUIRE(calls == 1);
+}
+
+TEST_CASE("A writer may call into gvc++ while output is streamed to it") {
+  const auto demand_loading = false;
+  auto gvc =
+      std::make_shared<GVC::GVContext>(lt_preloaded_symbols, demand_loading);
+
+  auto dot = "digraph {a -> b}";
+  auto g = std::make_shared<CGraph::AGraph>(dot);
+
+  const auto layout = GVC::GVLayout(gvc, g, "dot");
+
+  // the writer renders too, which would deadlock if it ran under the lock
+  std::string streamed;
+  std::string nested;
+  layout.render("svg", [&](std::string_view chunk) {
+    streamed += chunk;
+    if (nested.empty()) {
+      nested = std::string(layout.render("svg").string_view());
+    }
+  });
+
+  REQUIRE(streamed == nested);
+}
+
+TEST_CASE("The phases of a profiled layout and render can be retrieved") {
+  const auto demand_loading = false;
+  auto gvc =
+      std::make_shared<GVC::GVContext>(lt_preloaded_symbols, demand_loading);
+  gvc->setProfiling(true);
+
+  auto dot = "digraph {a -> b; b -> c; a -> c}";
+  auto g = std::make_shared<CGraph::AGraph>(dot);
+
+  const auto layout = GVC::GVLayout(gvc, g, "dot");
+  const auto result = layout.render("svg");
+  REQUIRE(result.length() > 0);
+
+  const std::string profile = gvc->profile();
+  REQUIRE(profile.front() == '[');
+  REQUIRE(profile.back() == ']');
+  REQUIRE(profile.find("\"layout\":\"dot\"") != std::string::npos);
+  REQUIRE(profile.find("\"name\":\"dot_mincross\"") != std::string::npos);
+  REQUIRE(profile.find("\"name\":\"gvRenderJobs\"") != std::string::npos);
+  REQUIRE(profile.find("\"ns_iterations\"") != std::string::npos);
+
+  // profiles are handed out once
+  REQUIRE(gvc->profile() == "[]");
+}
@@ -0,0 +1,147 @@
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <cgraph++/AGraph.h>
+#include <gvc++/GVContext.h>
+#include <gvc++/GVLayout.h>
+#include <gvc++/GVRenderData.h>
+
+namespace {
+
+/// number of graphs laid out by each run
+constexpr std::size_t corpus_size = 32;
+
+/// DOT source of a pseudo-random graph, the same for the same seed
+///
+/// The graphs mix clusters, labels, shapes and parallel edges, so the layouts
+/// go through ranking, crossing minimization, positioning and spline routing
+/// with some variety.
+std::string generate(unsigned seed) {
+  std::minstd_rand rng(seed);
+  const unsigned nodes = 10 + rng() % 40;
+  const unsigned edges = nodes + rng() % (2 * nodes);
+  const char *shapes[] = {"box", "ellipse", "record", "diamond", "circle"};
+
+  std::ostringstream dot;
+  dot << "digraph g" << seed << " {\n";
+  for (unsigned cluster = 0; cluster < 3; ++cluster) {
+    dot << "  subgraph cluster_" << cluster << " { label=\"cluster " << cluster
+        << "\";";
+    for (unsigned n = cluster; n < nodes; n += 7) {
+      dot << " n" << n << ";";
+    }
+    dot << " }\n";
+  }
+  for (unsigned n = 0; n < nodes; ++n) {
+    dot << "  n" << n << " [shape=" << shapes[rng() % 5] << ", label=\"node "
+        << n << "\"];\n";
+  }
+  for (unsigned e = 0; e < edges; ++e) {
+    dot << "  n" << rng() % nodes << " -> n" << rng() % nodes;
+    if (rng() % 4 == 0) {
+      dot << " [label=\"e" << e << "\"]";
+    }
+    dot << ";\n";
+  }
+  dot << "}\n";
+  return dot.str();
+}
+
+std::vector<std::string> make_corpus() {
+  std::vector<std::string> sources;
+  for (unsigned seed = 1; seed <= corpus_size; ++seed) {
+    sources.push_back(generate(seed));
+  }
+  return sources;
+}
+
+using graphs_t = std::vector<std::shared_ptr<CGraph::AGraph>>;
+
+/// parse every `stride`th graph, starting from `first`
+///
+/// Parsing is not covered by the GVLayout thread-safety guarantee, so this is
+/// always done on the main thread.
+graphs_t parse(const std::vector<std::string> &sources, std::size_t first,
+               std::size_t stride) {
+  graphs_t graphs;
+  for (std::size_t i = first; i < sources.size(); i += stride) {
+    graphs.push_back(std::make_shared<CGraph::AGraph>(sources[i]));
+  }
+  return graphs;
+}
+
+/// a context with the plugins linked into the test, or with the installed
+/// plugins when the test is built against an installed Graphviz by
+/// test_misc.py:test_gvlayout_threads
+std::shared_ptr<GVC::GVContext> make_context() {
+#ifdef USE_INSTALLED_PLUGINS
+  return std::make_shared<GVC::GVContext>();
+#else
+  const auto demand_loading = false;
+  return std::make_shared<GVC::GVContext>(lt_preloaded_symbols,
+                                          demand_loading);
+#endif
+}
+
+/// lay out and render the given graphs using a private context
+std::vector<std::string> render_all(const graphs_t &graphs) {
+  auto gvc = make_context();
+
+  std::vector<std::string> results;
+  for (const auto &g : graphs) {
+    const auto layout = GVC::GVLayout(gvc, g, "dot");
+    const auto result = layout.render("svg");
+    results.emplace_back(result.string_view());
+  }
+  return results;
+}
+
+} // namespace
+
+// The layouts below are serialized by the engine lock of gvc++, so this does
+// not show that the engines are reentrant. It shows that contexts and layouts
+// can be created, used and destroyed from several threads at once without
+// crashing or disturbing each other's results.
+TEST_CASE("Layouts on separate threads with separate contexts are identical "
+          "to single-threaded layouts") {
+  const auto sources = make_corpus();
+  REQUIRE(!sources.empty());
+
+  const std::vector<std::string> expected = render_all(parse(sources, 0, 1));
+  REQUIRE(expected.size() == sources.size());
+
+  const std::size_t n_threads = GENERATE(2, 4, 8);
+  INFO("threads: " << n_threads);
+
+  std::vector<graphs_t> inputs;
+  for (std::size_t t = 0; t < n_threads; ++t) {
+    inputs.push_back(parse(sources, t, n_threads));
+  }
+
+  std::vector<std::vector<std::string>> actual(n_threads);
+  {
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < n_threads; ++t) {
+      threads.emplace_back([&, t]() { actual[t] = render_all(inputs[t]); });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  for (std::size_t t = 0; t < n_threads; ++t) {
+    REQUIRE(actual[t].size() == inputs[t].size());
+    for (std::size_t j = 0; j < actual[t].size(); ++j) {
+      const std::size_t i = t + j * n_threads;
+      INFO("graph " << i);
+      REQUIRE(actual[t][j] == expected[i]);
+    }
+  }
+}
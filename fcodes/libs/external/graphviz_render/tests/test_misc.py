@@ -14,7 +14,7 @@ from pathlib import Path
 import pytest
 
 sys.path.append(os.path.dirname(__file__))
-from gvtest import ROOT, compile_c, dot  # pylint: disable=wrong-import-position
+from gvtest import ROOT, compile_c, dot, run_c  # pylint: disable=wrong-import-position
 
 
 def test_json_node_order():
@@ -228,3 +228,535 @@ def test_xml_escape():
                     assert escaped == f"character |{expected}|", "bad UTF-8 escaping"
                 else:
                     assert escaped == unescaped, "bad UTF-8 passthrough"
+
+
+@pytest.mark.skipif(
+    platform.system() == "Windows", reason="batch workers are processed serially"
+)
+@pytest.mark.parametrize("jobs", (1, 4))
+def test_batch(jobs: int):
+    """
+    `dot --batch` should process a stream of graphs, writing results in input
+    order and reporting errors per graph
+    """
+
+    graphs = [
+        f"digraph g{i} {{ a{i} -> b{i} -> c{i}; a{i} -> c{i}; }}" for i in range(8)
+    ]
+
+    # an HTML label with an unclosed tag is an error, but does not stop parsing
+    graphs[3] = "digraph g3 { a [label=<<b>x>]; }"
+
+    proc = subprocess.run(
+        ["dot", "-Tsvg", "--batch", f"-j{jobs}"],
+        input="\n".join(graphs).encode("utf-8"),
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        check=False,
+    )
+    assert proc.returncode != 0, "error in one graph was not reported"
+
+    # split the output into its frames
+    output = proc.stdout
+    results = []
+    while output:
+        header, output = output.split(b"\n", 1)
+        tag, index, status, length = header.decode("utf-8").split(" ")
+        assert tag == "graph", "malformed batch header"
+        results.append((int(index), int(status), output[: int(length)]))
+        output = output[int(length) :]
+
+    assert [r[0] for r in results] == list(range(len(graphs))), "incorrect order"
+    for index, status, svg in results:
+        if index == 3:
+            assert status != 0, "erroneous graph not flagged"
+            continue
+        assert status == 0, f"graph {index} unexpectedly failed"
+        assert svg.decode("utf-8") == dot("svg", source=graphs[index])
+
+    assert "graph 3:" in proc.stderr.decode("utf-8"), "error not attributed"
+
+
+@pytest.mark.skipif(
+    platform.system() == "Windows", reason="batch workers are processed serially"
+)
+def test_batch_syntax_error(tmp_path: Path):
+    """
+    an input of `dot --batch` that cannot be parsed should get an error result
+    of its own, and the batch should go on with the next input file
+    """
+
+    good = tmp_path / "good.gv"
+    good.write_text("digraph { a -> b; }", encoding="utf-8")
+    bad = tmp_path / "bad.gv"
+    bad.write_text("digraph { a -> ; }", encoding="utf-8")
+
+    proc = subprocess.run(
+        ["dot", "-Tsvg", "--batch", "-j2", good, bad, good],
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        check=False,
+    )
+    assert proc.returncode != 0, "syntax error was not reported"
+
+    output = proc.stdout
+    results = []
+    while output:
+        header, output = output.split(b"\n", 1)
+        tag, index, status, length = header.decode("utf-8").split(" ")
+        assert tag == "graph", "malformed batch header"
+        results.append((int(index), int(status), int(length)))
+        output = output[int(length) :]
+
+    assert [r[0] for r in results] == [0, 1, 2], "incorrect framing"
+    assert results[0][1] == 0 and results[0][2] > 0
+    assert results[1][1] != 0, "unparsable input not flagged"
+    assert results[1][2] == 0, "unparsable input produced output"
+    assert results[2][1] == 0 and results[2][2] > 0
+    assert "graph 1:" in proc.stderr.decode("utf-8"), "error not attributed"
+
+
+@pytest.mark.skipif(
+    platform.system() == "Windows", reason="batch workers are processed serially"
+)
+def test_batch_worker_dies(tmp_path: Path):
+    """
+    a `dot --batch` worker killed while writing its output should get an error
+    result, and the batch should go on with the next graph
+    """
+
+    # with -O, the workers write their output to files, so a file size limit
+    # kills the worker of the large graph with SIGXFSZ part way through it
+    large = tmp_path / "large.gv"
+    nodes = " ".join(f'n{i} [label="node number {i}"];' for i in range(400))
+    large.write_text(f"digraph {{ {nodes} }}", encoding="utf-8")
+    small = tmp_path / "small.gv"
+    small.write_text("digraph { a -> b; }", encoding="utf-8")
+
+    def limit_file_size():
+        import resource  # pylint: disable=import-outside-toplevel
+
+        resource.setrlimit(resource.RLIMIT_FSIZE, (16384, 16384))
+        resource.setrlimit(resource.RLIMIT_CORE, (0, 0))
+
+    proc = subprocess.run(
+        ["dot", "-Tsvg", "-O", "--batch", "-j2", large, small],
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        preexec_fn=limit_file_size,
+        check=False,
+    )
+    assert proc.returncode != 0, "killed worker was not reported"
+
+    output = proc.stdout
+    results = []
+    while output:
+        header, output = output.split(b"\n", 1)
+        tag, index, status, length = header.decode("utf-8").split(" ")
+        assert tag == "graph", "malformed batch header"
+        results.append((int(index), int(status)))
+        output = output[int(length) :]
+
+    assert [r[0] for r in results] == [0, 1], "incorrect framing"
+    assert results[0][1] != 0, "killed worker not flagged"
+    assert results[1][1] == 0, "graph after the killed worker failed"
+    stderr = proc.stderr.decode("utf-8")
+    assert "graph 0: worker terminated by signal" in stderr, "death not attributed"
+
+
+def test_batch_jobs_flag():
+    """
+    only `-j` and `-j<digits>` should be taken as the jobs flag of batch mode
+    """
+    proc = subprocess.run(
+        ["dot", "-Tsvg", "-jx"], input=b"digraph {}", capture_output=True, check=False
+    )
+    assert "-j flag requires --batch" not in proc.stderr.decode("utf-8")
+
+
+def test_batch_requires_flag():
+    """
+    `-j` is only meaningful in batch mode
+    """
+    proc = subprocess.run(
+        ["dot", "-Tsvg", "-j2"], input=b"digraph {}", capture_output=True, check=False
+    )
+    assert proc.returncode != 0, "-j without --batch accepted"
+
+
+def test_incremental():
+    """
+    `incremental=true` should start dot from a previous layout, keeping the
+    relative placement of existing nodes across an edit that reorders them in a
+    fresh layout
+    """
+
+    def positions(source: str) -> dict:
+        layout = json.loads(dot("json", source=source))
+        return {
+            o["name"]: tuple(float(v) for v in o["pos"].split(","))
+            for o in layout["objects"]
+            if "pos" in o
+        }
+
+    before = positions("digraph { a -> b; a -> c; }")
+    assert before["b"][0] < before["c"][0], "unexpected initial layout"
+
+    # The edit adds n and lists the edges of a in another order. Laid out
+    # afresh, this swaps b and c.
+    edited = "a -> c; a -> b; a -> n;"
+    fresh = positions(f"digraph {{ {edited} }}")
+    assert fresh["c"][0] < fresh["b"][0], "edit does not reorder a full layout"
+
+    previous = " ".join(f'{n} [pos="{x},{y}"];' for n, (x, y) in before.items())
+    after = positions(f"digraph {{ incremental=true; {edited} {previous} }}")
+
+    # existing nodes keep their ranks and their left-to-right order
+    assert after["a"][1] > after["b"][1], "a no longer above b"
+    assert after["b"][1] == after["c"][1], "b and c no longer on one rank"
+    assert after["b"][0] < after["c"][0], "b and c swapped"
+
+    # the new node is ranked with its siblings
+    assert after["n"][1] == after["b"][1], "new node not beside its siblings"
+
+
+def test_sparse_sgd():
+    """
+    `mode=sparse_sgd` should lay out a graph close to its ideal edge lengths
+    without computing all pairs shortest paths
+    """
+
+    width = 12
+    edges = [f"n{x}_{y} -- n{x + 1}_{y};" for x in range(width - 1) for y in range(width)]
+    edges += [f"n{x}_{y} -- n{x}_{y + 1};" for x in range(width) for y in range(width - 1)]
+    source = "graph { node [shape=point]; " + " ".join(edges) + " }"
+
+    proc = subprocess.run(
+        ["neato", "-Gmode=sparse_sgd", "-Tplain"],
+        input=source,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        universal_newlines=True,
+        check=True,
+    )
+    assert proc.stderr == "", "unexpected warnings"
+
+    positions = {}
+    lengths = []
+    for line in proc.stdout.splitlines():
+        fields = line.split()
+        if fields[0] == "node":
+            positions[fields[1]] = (float(fields[2]), float(fields[3]))
+        elif fields[0] == "edge":
+            (tx, ty), (hx, hy) = positions[fields[1]], positions[fields[2]]
+            lengths.append(((tx - hx) ** 2 + (ty - hy) ** 2) ** 0.5)
+
+    assert len(positions) == width * width, "missing nodes"
+    # the default edge length is one inch
+    mean = sum(lengths) / len(lengths)
+    assert 0.8 < mean < 1.2, "edge lengths far from their ideal"
+
+
+@pytest.mark.skipif(
+    platform.system() != "Linux", reason="TODO: make this test case portable"
+)
+def test_quadtree_forces(tmp_path: Path):
+    """
+    sfdp's flat quadtree should compute the same repulsive forces as the
+    pointer-based quadtree it replaced
+    """
+
+    # locate our test program
+    c_src = Path(__file__).parent / "quadtree_forces.c"
+    assert c_src.exists(), "missing test case"
+
+    # write a dummy config.h to allow standalone compilation
+    (tmp_path / "config.h").write_text("", encoding="utf-8")
+
+    # compile it with the quadtree sources, with OpenMP so the blocked
+    # traversal of larger point sets is covered too
+    sparse = ROOT / "lib/sparse"
+    cflags = [
+        "-D_POSIX_C_SOURCE=200809L",
+        "-fopenmp",
+        "-I",
+        tmp_path,
+        "-I",
+        ROOT / "lib",
+        "-I",
+        ROOT / "lib/common",
+        "-I",
+        ROOT / "lib/cgraph",
+        "-I",
+        ROOT / "lib/cdt",
+        sparse / "QuadTree.c",
+        sparse / "LinkedList.c",
+        sparse / "general.c",
+        "-lm",
+    ]
+    exe = compile_c(c_src, cflags, dst=tmp_path / "quadtree_forces.exe")
+
+    subprocess.check_call([exe])
+
+
+def test_gvlayout_threads(tmp_path: Path):
+    """
+    gvc++ layouts on separate threads, each with its own context, should match
+    those done on one thread
+    """
+
+    # FIXME: Remove skip when
+    # https://gitlab.com/graphviz/graphviz/-/issues/1777 is fixed
+    if os.getenv("build_system") == "msbuild":
+        pytest.skip("Windows MSBuild release does not contain any header files (#1777)")
+
+    # find co-located test source and the Catch2 entry point
+    src = (Path(__file__).parent / "test_GVLayout_threads.cpp").resolve()
+    assert src.exists(), "missing test case"
+    main = (Path(__file__).parent / "catch2_main.cpp").resolve()
+    assert main.exists(), "missing Catch2 entry point"
+
+    exe = compile_c(
+        src,
+        cflags=[str(main), "-DUSE_INSTALLED_PLUGINS", "-pthread"],
+        link=["gvc++", "cgraph++", "gvc", "cgraph"],
+        dst=tmp_path / "test_GVLayout_threads.exe",
+    )
+    subprocess.check_call([exe])
+
+
+def test_text_cache():
+    """
+    text sizes should be cached per context, and the cache should be possible
+    to disable
+    """
+
+    # FIXME: Remove skip when
+    # https://gitlab.com/graphviz/graphviz/-/issues/1777 is fixed
+    if os.getenv("build_system") == "msbuild":
+        pytest.skip("Windows MSBuild release does not contain any header files (#1777)")
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / "text_cache.c").resolve()
+    assert c_src.exists(), "missing test case"
+
+    _, _ = run_c(c_src, link=["cgraph", "gvc"])
+
+
+def test_text_cache_option(tmp_path: Path):
+    """
+    `--no-text-cache` should have every label measured
+    """
+
+    source = (
+        "digraph { a [label=Smith]; b [label=Smith]; c [label=Smith]; "
+        "a -> b -> c; }"
+    )
+    profile = tmp_path / "profile.jsonl"
+
+    def hits(*options: str) -> int:
+        subprocess.run(
+            ["dot", "-Tsvg", f"--profile={profile}", *options],
+            input=source,
+            stdout=subprocess.DEVNULL,
+            universal_newlines=True,
+            check=True,
+        )
+        record = json.loads(profile.read_text().splitlines()[-1])
+        return record["counters"].get("text_cache_hits", 0)
+
+    assert hits() > 0, "repeated labels not taken from the cache"
+    assert hits("--no-text-cache") == 0, "cache used when disabled"
+
+
+def test_text_cache_lasi(tmp_path: Path):
+    """
+    the LASi renderer draws from text layouts, so it should bypass the text
+    cache, and draw text in a font that has no PostScript alias
+    """
+
+    source = (
+        'digraph { node [fontname="Unaliased Sans"]; '
+        "a [label=Smith]; b [label=Smith]; c [label=Smith]; a -> b -> c; }"
+    )
+    profile = tmp_path / "profile.jsonl"
+    proc = subprocess.run(
+        ["dot", "-Tps:lasi", f"--profile={profile}"],
+        input=source,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        universal_newlines=True,
+    )
+    if "not recognized" in proc.stderr:
+        pytest.skip("LASi renderer not available")
+    assert proc.returncode == 0, "rendering with LASi failed"
+    assert "%%PageTrailer" in proc.stdout, "truncated output"
+
+    record = json.loads(profile.read_text().splitlines()[-1])
+    assert "text_cache_hits" not in record["counters"], "text cache consulted"
+
+
+def test_render_sink():
+    """
+    output streamed to a sink should match output rendered to memory, and a
+    sink refusing output should fail the render
+    """
+
+    # FIXME: Remove skip when
+    # https://gitlab.com/graphviz/graphviz/-/issues/1777 is fixed
+    if os.getenv("build_system") == "msbuild":
+        pytest.skip("Windows MSBuild release does not contain any header files (#1777)")
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / "render_sink.c").resolve()
+    assert c_src.exists(), "missing test case"
+
+    _, _ = run_c(c_src, link=["cgraph", "gvc"])
+
+
+def test_arena():
+    """
+    graphs read with `--arena` should lay out exactly as without it
+    """
+
+    source = (
+        "digraph { compound=true; node [label=<<b>n</b>>]; "
+        "subgraph cluster_a { a1 -> a2 -> a3; } "
+        "subgraph cluster_b { b1 -> b2; b1 -> b3; } "
+        "a1 -> b1 [lhead=cluster_b]; a3 -> b3 -> a1; "
+        'c [shape=record, label="{x|y}"]; }'
+    )
+
+    outputs = []
+    for args in ([], ["--arena"]):
+        proc = subprocess.run(
+            ["dot", "-Tdot"] + args,
+            input=source,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE,
+            universal_newlines=True,
+            check=True,
+        )
+        assert proc.stderr == "", "unexpected warnings"
+        outputs.append(proc.stdout)
+
+    assert outputs[0] == outputs[1], "arena storage changed the layout"
+
+
+def test_arena_allocations(tmp_path: Path):
+    """
+    graphs read with `agreadarena(1)` should take their storage from the arena,
+    making far fewer calls into the allocator
+    """
+
+    # FIXME: Remove skip when
+    # https://gitlab.com/graphviz/graphviz/-/issues/1777 is fixed
+    if os.getenv("build_system") == "msbuild":
+        pytest.skip("Windows MSBuild release does not contain any header files (#1777)")
+
+    # the benchmark worker counts allocations
+    c_src = (Path(__file__).parent / "arena_benchmark.c").resolve()
+    assert c_src.exists(), "missing test case"
+    worker = compile_c(c_src, link=["cgraph", "gvc"], dst=tmp_path / "worker.exe")
+
+    graph = tmp_path / "graph.gv"
+    nodes = [f'n{i} [label="{{n{i}|x}}"];' for i in range(500)]
+    edges = [f"n{i} -> n{(7 * i + 1) % 500};" for i in range(500)]
+    graph.write_text("digraph { " + " ".join(nodes + edges) + " }", encoding="utf-8")
+
+    allocs = {}
+    for mode in ("malloc", "arena"):
+        out = subprocess.check_output(
+            [worker, mode, "none", "1", graph], universal_newlines=True
+        )
+        allocs[mode] = out.split()[0]
+
+    if allocs["malloc"] == "-":
+        pytest.skip("allocations are only counted with glibc")
+    assert int(allocs["arena"]) * 2 < int(allocs["malloc"]), "arena not used"
+
+
+def test_arena_close():
+    """
+    closing an arena graph object by object, as for subgraphs or when callbacks
+    or a custom ID discipline are in use, should not free arena storage
+    """
+
+    # FIXME: Remove skip when
+    # https://gitlab.com/graphviz/graphviz/-/issues/1777 is fixed
+    if os.getenv("build_system") == "msbuild":
+        pytest.skip("Windows MSBuild release does not contain any header files (#1777)")
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / "arena_close.c").resolve()
+    assert c_src.exists(), "missing test case"
+
+    _, _ = run_c(c_src, link=["cgraph"])
+
+
+def test_profile(tmp_path: Path):
+    """
+    `--profile` should write the phases and counters of each graph as JSON
+    """
+
+    source = (
+        "digraph first { a -> b -> c; a -> c; subgraph cluster_x { d -> e; } }\n"
+        "digraph second { x -> y; }\n"
+    )
+    profile = tmp_path / "profile.jsonl"
+
+    subprocess.run(
+        ["dot", "-Tsvg", f"--profile={profile}"],
+        input=source,
+        stdout=subprocess.DEVNULL,
+        universal_newlines=True,
+        check=True,
+    )
+
+    records = [json.loads(line) for line in profile.read_text().splitlines()]
+    assert [r["graph"] for r in records] == ["first", "second"]
+
+    def names(spans):
+        for span in spans:
+            assert span["calls"] >= 1, "span recorded without a call"
+            assert span["seconds"] >= 0, "negative time"
+            yield span["name"]
+            yield from names(span["children"])
+
+    for record in records:
+        assert record["layout"] == "dot"
+        phases = set(names(record["spans"]))
+        for phase in (
+            "gvLayoutJobs",
+            "dot_rank",
+            "rank2",
+            "dot_mincross",
+            "dot_position",
+            "dot_splines",
+            "gvRenderJobs",
+            "emit_graph",
+        ):
+            assert phase in phases, f"{phase} missing from profile"
+        counters = record["counters"]
+        for counter in ("ns_iterations", "mincross_passes", "spline_routes"):
+            assert counter in counters, f"{counter} missing from profile"
+        assert counters["spline_routes"] >= 1
+
+
+def test_profile_attribute():
+    """
+    a graph with `profile=true` should have its profile written to stderr
+    """
+
+    proc = subprocess.run(
+        ["dot", "-Tsvg", "-Kneato"],
+        input="graph { profile=true; a -- b -- c -- a; }",
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.PIPE,
+        universal_newlines=True,
+        check=True,
+    )
+
+    record = json.loads(proc.stderr)
+    assert record["layout"] == "neato"
+    assert "neato_iterations" in record["counters"]
@@ -0,0 +1,49 @@
+// see test_misc.py:test_text_cache
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <graphviz/gvc.h>
+#include <stddef.h>
+#include <stdio.h>
+
+static void layout(GVC_t *gvc, const char *source) {
+  Agraph_t *g = agmemread(source);
+  assert(g != NULL);
+  int r = gvLayout(gvc, g, "dot");
+  assert(r == 0);
+  gvFreeLayout(gvc, g);
+  agclose(g);
+}
+
+int main(void) {
+  const char *source = "digraph { a [label=Smith]; b [label=Smith]; "
+                       "c [label=Smith]; a -> b -> c; }";
+  size_t hits, misses;
+
+  GVC_t *gvc = gvContext();
+  assert(gvc != NULL);
+
+  // repeated labels are measured once
+  layout(gvc, source);
+  gvTextCacheStats(gvc, &hits, &misses);
+  printf("hits %zu, misses %zu\n", hits, misses);
+  assert(hits > 0);
+
+  // the cache is shared by the graphs of a context
+  size_t misses_before = misses;
+  layout(gvc, source);
+  gvTextCacheStats(gvc, &hits, &misses);
+  printf("hits %zu, misses %zu\n", hits, misses);
+  assert(misses == misses_before);
+
+  // a disabled cache is not consulted
+  gvTextCache(gvc, false);
+  size_t hits_before = hits;
+  layout(gvc, source);
+  gvTextCacheStats(gvc, &hits, &misses);
+  printf("hits %zu, misses %zu\n", hits, misses);
+  assert(hits == hits_before);
+
+  gvFreeContext(gvc);
+  return 0;
+}